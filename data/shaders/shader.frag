@@ -8,13 +8,101 @@ layout (location = 0) in VertexInput {
     vec2 uvs;
 };
 
-layout (set = 0, binding = 3) uniform sampler2D[] textures;
+struct VirtualInfo {
+    uint indirection;
+    uint atlas;
+    uint pages_x;
+    uint pages_y;
+    uint mips;
+    uint first_page;
+    uint atlas_pages;
+    uint page_size;
+    uint page_border;
+};
+
+layout (set = 0, binding = 2) buffer Feedback {
+    uint requested[];
+};
+
+layout (set = 0, binding = 3) readonly buffer VirtualTextures {
+    VirtualInfo virtuals[];
+};
+
+layout (set = 0, binding = 4) buffer VirtualFeedback {
+    uint pages[];
+};
+
+layout (set = 0, binding = 5) uniform sampler2D[] textures;
 
 layout (push_constant) uniform Constants {
     uint transform_index;
     uint texture_index;
+    float max_lod;
+    vec4 uv_transform;
 };
 
+const uint virtual_texture_bit = 1u << 31;
+
+bool writes_feedback() {
+    // Only one pixel out of each 4x4 block writes feedback, to keep contention on the feedback buffers down.
+    return (uint(gl_FragCoord.x) & 3u) == 0u && (uint(gl_FragCoord.y) & 3u) == 0u;
+}
+
+vec4 sample_virtual(uint index, vec2 uv) {
+    VirtualInfo info = virtuals[index];
+    if (info.mips == 0u) {
+        return texture(textures[0], uv);
+    }
+    uvec2 size = uvec2(info.pages_x, info.pages_y);
+    float page_size = float(info.page_size);
+    float page_border = float(info.page_border);
+    vec2 texels = uv * vec2(size) * page_size;
+    vec2 dx = dFdx(texels);
+    vec2 dy = dFdy(texels);
+    uint mip = uint(clamp(0.5 * log2(max(dot(dx, dx), dot(dy, dy))), 0.0, float(info.mips - 1u)));
+
+    // Pages are numbered like the indirection texture's texels, finest mip first and row major.
+    uvec2 level = max(size >> mip, uvec2(1u));
+    uvec2 page = min(uvec2(fract(uv) * vec2(level)), level - 1u);
+    uint offset = info.first_page;
+    for (uint i = 0u; i < mip; ++i) {
+        uvec2 each = max(size >> i, uvec2(1u));
+        offset += each.x * each.y;
+    }
+    uint bit = offset + page.y * level.x + page.x;
+    if (writes_feedback()) {
+        atomicOr(pages[bit >> 5u], 1u << (bit & 31u));
+    }
+
+    // The entry holds the atlas page and mip of the finest resident page covering this one.
+    uvec4 entry = uvec4(texelFetch(textures[info.indirection], ivec2(page), int(mip)) * 255.0 + 0.5);
+    if (entry.a == 0u) {
+        return texture(textures[0], uv);
+    }
+    vec2 local = fract(fract(uv) * vec2(max(size >> entry.b, uvec2(1u))));
+    float padded = page_size + 2.0 * page_border;
+    vec2 atlas_uv = (vec2(entry.xy) * padded + page_border + local * page_size) / (float(info.atlas_pages) * padded);
+    return textureLod(textures[info.atlas], atlas_uv, 0.0);
+}
+
 void main() {
-    fragment = vec4(texture(textures[texture_index], uvs));
+    if ((texture_index & virtual_texture_bit) != 0u) {
+        fragment = sample_virtual(texture_index & ~virtual_texture_bit, uvs);
+        return;
+    }
+    // Report the finest UV footprint the texture is sampled with, positive floats order like their bits do.
+    vec2 footprint = max(abs(dFdx(uvs)), abs(dFdy(uvs)));
+    // The feedback buffer only has room for the textures the streamer tracks.
+    if (writes_feedback() && texture_index < uint(requested.length())) {
+        atomicMin(requested[texture_index], floatBitsToUint(max(footprint.x, footprint.y)));
+    }
+    // Packed textures only cover part of their atlas page, gradients come from the unwrapped UVs to avoid seams.
+    vec2 scale = uv_transform.xy;
+    vec2 dx = dFdx(uvs) * scale;
+    vec2 dy = dFdy(uvs) * scale;
+    // Atlas entries only have mips down to their own size, coarser page mips would mix in their neighbours.
+    vec2 size = vec2(textureSize(textures[texture_index], 0));
+    float lod = 0.5 * log2(max(dot(dx * size, dx * size), dot(dy * size, dy * size)));
+    float excess = exp2(max(lod - max_lod, 0.0));
+    fragment = textureGrad(textures[texture_index], fract(uvs) * scale + uv_transform.zw, dx / excess, dy / excess);
 }
@@ -26,6 +26,8 @@ readonly buffer Transforms {
 layout (push_constant) uniform Constants {
     uint transform_index;
     uint texture_index;
+    float max_lod;
+    vec4 uv_transform;
 };
 
 void main() {
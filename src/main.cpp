@@ -1,7 +1,12 @@
+#include <qz/gfx/texture_streamer.hpp>
+#include <qz/gfx/transform_store.hpp>
+#include <qz/gfx/virtual_texture.hpp>
 #include <qz/gfx/descriptor_set.hpp>
 #include <qz/gfx/static_texture.hpp>
 #include <qz/gfx/static_model.hpp>
+#include <qz/gfx/task_manager.hpp>
 #include <qz/gfx/render_pass.hpp>
+#include <qz/gfx/task_graph.hpp>
 #include <qz/gfx/static_mesh.hpp>
 #include <qz/gfx/pipeline.hpp>
 #include <qz/gfx/renderer.hpp>
@@ -12,20 +17,73 @@
 #include <qz/gfx/queue.hpp>
 
 #include <qz/meta/constants.hpp>
+#include <qz/meta/types.hpp>
 
 #include <glm/mat4x4.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
-#include <span>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <vector>
+#include <optional>
+#include <utility>
+#include <tuple>
+#include <array>
 
 using namespace qz;
 
+struct DrawConstants {
+    std::uint32_t transform_index;
+    std::uint32_t texture_index;
+    float max_lod;
+    std::uint32_t padding;
+    glm::vec4 uv_transform;
+};
+
+// Buffers are resolved while building the snapshot, workers recording draws never take the mesh storage's lock.
+struct Draw {
+    VkBuffer geometry;
+    VkBuffer indices;
+    std::uint32_t index_count;
+    DrawConstants constants;
+};
+
+// Smallest share of the draw list worth a secondary command buffer of its own.
+constexpr auto draws_per_chunk = 256u;
+
 struct Camera {
     struct Raw {
         glm::mat4 projection;
         glm::mat4 view;
     };
+    // Window state is only readable on the main thread, the camera itself may be updated anywhere.
+    struct Input {
+        bool forward;
+        bool backward;
+        bool left;
+        bool right;
+        bool up;
+        bool down;
+        gfx::Point mouse;
+
+        qz_nodiscard static Input sample(const gfx::Window& window) noexcept {
+            const auto pressed = [&window](gfx::Keys key) {
+                return window.get_key_state(key) == gfx::KeyState::pressed;
+            };
+            return {
+                pressed(gfx::Keys::W),
+                pressed(gfx::Keys::S),
+                pressed(gfx::Keys::A),
+                pressed(gfx::Keys::D),
+                pressed(gfx::Keys::space),
+                pressed(gfx::Keys::left_shift),
+                window.get_mouse_offset()
+            };
+        }
+    };
     glm::vec3 position = {1.2f, 0.4f, 0.0f };
     glm::vec3 front = { 0.0f, 0.0f, -1.0f };
     glm::vec3 up = { 0.0f, 1.0f, 0.0f };
@@ -34,9 +92,9 @@ struct Camera {
     float yaw = -180.0f;
     float pitch = 0.0f;
 
-    void update(const gfx::Window& window, double delta_time) noexcept {
-        _process_keyboard(window, delta_time);
-        _process_mouse(window);
+    void update(const Input& input, double delta_time) noexcept {
+        _process_keyboard(input, delta_time);
+        _process_mouse(input);
 
         const auto cos_pitch = std::cos(glm::radians(pitch));
         front = glm::normalize(glm::vec3{
@@ -52,33 +110,33 @@ struct Camera {
         return glm::lookAt(position, position + front, up);
     }
 private:
-    void _process_keyboard(const gfx::Window& window, double delta_time) noexcept {
+    void _process_keyboard(const Input& input, double delta_time) noexcept {
         constexpr auto camera_speed = 1.5f;
         const auto delta_movement = camera_speed * (float)delta_time;
-        if (window.get_key_state(gfx::Keys::W) == gfx::KeyState::pressed) {
+        if (input.forward) {
             position.x += std::cos(glm::radians(yaw)) * delta_movement;
             position.z += std::sin(glm::radians(yaw)) * delta_movement;
         }
-        if (window.get_key_state(gfx::Keys::S) == gfx::KeyState::pressed) {
+        if (input.backward) {
             position.x -= std::cos(glm::radians(yaw)) * delta_movement;
             position.z -= std::sin(glm::radians(yaw)) * delta_movement;
         }
-        if (window.get_key_state(gfx::Keys::A) == gfx::KeyState::pressed) {
+        if (input.left) {
             position -= right * delta_movement;
         }
-        if (window.get_key_state(gfx::Keys::D) == gfx::KeyState::pressed) {
+        if (input.right) {
             position += right * delta_movement;
         }
-        if (window.get_key_state(gfx::Keys::space) == gfx::KeyState::pressed) {
+        if (input.up) {
             position += world_up * delta_movement;
         }
-        if (window.get_key_state(gfx::Keys::left_shift) == gfx::KeyState::pressed) {
+        if (input.down) {
             position -= world_up * delta_movement;
         }
     }
 
-    void _process_mouse(const gfx::Window& window) noexcept {
-        const auto [xoff, yoff] = window.get_mouse_offset();
+    void _process_mouse(const Input& input) noexcept {
+        const auto [xoff, yoff] = input.mouse;
         yaw += (float)xoff;
         pitch += (float)yoff;
 
@@ -91,36 +149,48 @@ private:
     }
 };
 
-int main() {
-    auto window = gfx::Window::create(1280, 720, "QuartzVk");
-    auto context = gfx::Context::create();
-    auto renderer = gfx::Renderer::create(context, window);
+// Everything the render stage of a frame reads, written by the simulation stage one frame ahead.
+struct Snapshot {
+    Camera::Raw camera;
+    std::vector<glm::mat4> transforms;
+    std::vector<Draw> draws;
+};
+
+int main(int argc, char** argv) {
+    // Headless runs render a fixed number of frames offscreen and report their timing, for automated performance runs.
+    const auto headless = argc > 1 && std::strcmp(argv[1], "--headless") == 0;
+    const auto headless_frames = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1000ull;
+    auto window = headless ? gfx::Window() : gfx::Window::create(1280, 720, "QuartzVk");
+    // Deployments pick between latency and throughput without rebuilding.
+    const auto* frames_in_flight = std::getenv("QUARTZ_FRAMES_IN_FLIGHT");
+    auto context = gfx::Context::create({
+        .frames_in_flight = frames_in_flight ? (std::uint32_t)std::strtoul(frames_in_flight, nullptr, 10) : 2u,
+        .headless = headless
+    });
+    auto renderer = headless ?
+        gfx::Renderer::create(context, VkExtent2D{ 1280, 720 }) :
+        gfx::Renderer::create(context, window);
 
     auto render_pass = gfx::RenderPass::create(context, {
         .attachments = { {
-            .image = gfx::Image::create(context, {
-                .width = 1280,
-                .height = 720,
-                .mips = 1,
-                .format = renderer.swapchain.format,
-                .usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT
-            }),
+            .swapchain = &renderer.swapchain,
             .name = "color",
-            .framebuffers = { 0 },
-            .owning = true,
+            .framebuffers = {},
+            .owning = false,
             .discard = false,
-            .layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            .layout = renderer.swapchain.layout,
             .clear = gfx::ClearColor{}
         }, {
             .image = gfx::Image::create(context, {
-                .width = 1280,
-                .height = 720,
+                .width = renderer.swapchain.extent.width,
+                .height = renderer.swapchain.extent.height,
                 .mips = 1,
                 .format = VK_FORMAT_D32_SFLOAT_S8_UINT,
                 .usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT
             }),
+            .swapchain = nullptr,
             .name = "depth",
-            .framebuffers = { 0 },
+            .framebuffers = {},
             .owning = true,
             .discard = true,
             .layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
@@ -158,18 +228,20 @@ int main() {
         },
         .render_pass = &render_pass,
         .subpass = 0,
-        .depth = true
+        .depth = true,
+        .dynamic_offsets = { "Camera" }
     });
 
     auto set = gfx::DescriptorSet<>::allocate(context, pipeline.set(0));
-    auto camera_buf = gfx::Buffer<>::allocate(context, sizeof(Camera::Raw), meta::uniform_buffer);
-    auto model_buf = gfx::Buffer<>::allocate(context, meta::dynamic_size, meta::storage_buffer);
+    // Virtual texture buffers never change, they're written once instead of every frame.
+    for (std::uint32_t i = 0; i < meta::max_in_flight; ++i) {
+        gfx::DescriptorSet<1>::bind(context, set[i], pipeline["VirtualTextures"], context.virtual_textures->info(i));
+        gfx::DescriptorSet<1>::bind(context, set[i], pipeline["VirtualFeedback"], context.virtual_textures->feedback(i));
+    }
+    auto transform_store = gfx::TransformStore::create(context, renderer);
 
     Camera camera;
-    Camera::Raw camera_data = {
-        glm::perspective(glm::radians(60.0f), window.width() / (float)window.height(), 0.1f, 100.0f),
-        camera.view()
-    };
+    const auto projection = glm::perspective(glm::radians(60.0f), renderer.swapchain.extent.width / (float)renderer.swapchain.extent.height, 0.1f, 100.0f);
 
     std::vector<glm::mat4> models{
         //glm::scale(glm::mat4(1.0f), glm::vec3(0.01f)),
@@ -185,98 +257,220 @@ int main() {
         gfx::StaticModel::request(context, "../data/models/plane/plane.obj")
     };
 
-    std::size_t frame_count = 0;
-    double delta_time = 0, last_frame = 0;
-    while (!window.should_close()) {
-        auto [command_buffer, frame] = gfx::acquire_next_frame(renderer, context);
-        ++frame_count;
-
-        const auto current_frame = gfx::get_time();
-        delta_time = current_frame - last_frame;
-        last_frame = current_frame;
-
-        const auto transform_size = models.size() * sizeof(glm::mat4);
-        gfx::Buffer<1>::resize(context, model_buf[frame.index], transform_size);
-
-        camera_data.view = camera.view();
-        camera_buf[frame.index].write(&camera_data, meta::whole_size);
-        model_buf[frame.index].write(models.data(), transform_size);
+    // A pre-tiled ".qvt" file replaces the plane's texture, streamed through the virtual texture cache.
+    constexpr auto virtual_model = 2u;
+    const auto* virtual_path = std::getenv("QUARTZ_VIRTUAL_TEXTURE");
+    const auto virtual_texture = virtual_path ? context.virtual_textures->request(context, virtual_path) : std::nullopt;
 
-        gfx::DescriptorSet<1>::bind(context, set[frame.index], pipeline["Camera"], camera_buf[frame.index]);
-        gfx::DescriptorSet<1>::bind(context, set[frame.index], pipeline["Transforms"], model_buf[frame.index]);
-        gfx::DescriptorSet<1>::bind(context, set[frame.index], pipeline["textures"], assets::all_textures(context));
+    std::size_t frame_count = 0;
+    double delta_time = 0, last_frame = gfx::get_time();
+    Camera::Input input{};
+    gfx::CommandBuffer command_buffer;
+    gfx::FrameInfo frame;
+    std::vector<gfx::CommandBuffer> secondaries;
+    // Offsets of this frame's allocations, in the order of their bindings.
+    std::array<std::uint32_t, 1> dynamic_offsets{};
 
-        command_buffer
-            .begin()
-                .begin_render_pass(render_pass, 0)
-                .set_viewport(meta::full_viewport)
-                .set_scissor(meta::full_scissor)
-                .bind_pipeline(pipeline)
-                .bind_descriptor_set(set[frame.index]);
+    // Frame N + 1 is simulated into the next snapshot while frame N is recorded from the current one.
+    std::array<Snapshot, 2> snapshots;
+    std::size_t current = 1, next = 0;
 
-        {
+    auto simulation = gfx::TaskGraph::create(context, { {
+        .name = "camera",
+        .after = {},
+        .reads = { "input" },
+        .writes = { "camera" },
+        .function = [&]() {
+            camera.update(input, delta_time);
+            snapshots[next].camera = { projection, camera.view() };
+        },
+        .pinned = false
+    }, {
+        .name = "transforms",
+        .after = {},
+        .reads = { "models" },
+        .writes = { "transforms" },
+        .function = [&]() {
+            snapshots[next].transforms = models;
+        },
+        .pinned = false
+    }, {
+        .name = "visibility",
+        .after = {},
+        .reads = { "scene" },
+        .writes = { "draws" },
+        .function = [&]() {
+            auto& draws = snapshots[next].draws;
+            draws.clear();
             const auto lock = assets::acquire<gfx::StaticModel>();
+            const auto mesh_lock = assets::acquire<gfx::StaticMesh>();
+            const auto texture_lock = assets::acquire<gfx::StaticTexture>();
             for (std::size_t i = 0; i < scene.size(); ++i) {
                 qz_likely_if(assets::is_ready(scene[i])) {
                     for (const auto& [mesh, diffuse, normal, specular, vertex, index] : assets::from_handle(scene[i]).submeshes) {
-                        const std::array indices{
+                        qz_unlikely_if(!assets::is_ready(mesh)) {
+                            continue;
+                        }
+                        const auto& buffers = assets::from_handle(mesh);
+                        qz_unlikely_if(virtual_texture && i == virtual_model) {
+                            draws.push_back({ buffers.geometry.handle, buffers.indices.handle, static_cast<std::uint32_t>(index), {
+                                static_cast<std::uint32_t>(i),
+                                *virtual_texture,
+                                VK_LOD_CLAMP_NONE,
+                                {},
+                                glm::vec4(1.0f, 1.0f, 0.0f, 0.0f)
+                            } });
+                            continue;
+                        }
+                        const auto* texture = assets::is_ready(diffuse) ? &assets::from_handle(diffuse) : nullptr;
+                        draws.push_back({ buffers.geometry.handle, buffers.indices.handle, static_cast<std::uint32_t>(index), {
                             static_cast<std::uint32_t>(i),
-                            static_cast<std::uint32_t>(diffuse.index)
-                        };
-                        command_buffer
-                            .bind_static_mesh(mesh)
-                            .push_constants(VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, std::span(indices).size_bytes(), indices.data())
-                            .draw_indexed(index, 1, 0, 0);
+                            static_cast<std::uint32_t>(diffuse.index),
+                            texture ? texture->max_lod() : VK_LOD_CLAMP_NONE,
+                            {},
+                            texture ? texture->uv_transform() : glm::vec4(1.0f, 1.0f, 0.0f, 0.0f)
+                        } });
                     }
                 }
             }
-        }
+        },
+        .pinned = false
+    } });
+
+    auto rendering = gfx::TaskGraph::create(context, { {
+        .name = "camera_upload",
+        .after = {},
+        .reads = {},
+        .writes = { "camera_data" },
+        .function = [&]() {
+            const auto camera_data = context.frame_allocator->allocate(sizeof(Camera::Raw), meta::uniform_buffer);
+            std::memcpy(camera_data.mapped, &snapshots[current].camera, sizeof(Camera::Raw));
+            dynamic_offsets[0] = camera_data.offset;
+        },
+        .pinned = false
+    }, {
+        .name = "transforms",
+        .after = {},
+        .reads = {},
+        .writes = { "transform_store" },
+        .function = [&]() {
+            // Unchanged transforms are skipped by the store, only moved instances are uploaded.
+            const auto& transforms = snapshots[current].transforms;
+            for (std::uint32_t i = 0; i < transforms.size(); ++i) {
+                qz_likely_if(i < transform_store.size()) {
+                    transform_store.update(i, transforms[i]);
+                } else {
+                    (void)transform_store.insert(transforms[i]);
+                }
+            }
+        },
+        .pinned = false
+    }, {
+        .name = "descriptors",
+        .after = {},
+        .reads = {},
+        .writes = { "set" },
+        .function = [&]() {
+            gfx::DescriptorSet<1>::bind(context, set[frame.index], pipeline["Camera"], context.frame_allocator->buffer(frame.index, sizeof(Camera::Raw)));
+            gfx::DescriptorSet<1>::bind(context, set[frame.index], pipeline["Feedback"], context.streamer->feedback(frame.index));
+            gfx::DescriptorSet<1>::bind(context, set[frame.index], pipeline["textures"], assets::all_textures(context));
+        },
+        .pinned = false
+    }, {
+        .name = "draws",
+        .after = {},
+        .reads = { "set", "camera_data", "transform_store" },
+        .writes = { "commands" },
+        .function = [&]() {
+            // The scatter may grow the transform buffer, its descriptor is written before any draw is recorded.
+            command_buffer.begin();
+            transform_store.flush(context, command_buffer, frame.index);
+            gfx::DescriptorSet<1>::bind(context, set[frame.index], pipeline["Transforms"], transform_store.info());
+            context.virtual_textures->record(context, command_buffer, frame.index);
+
+            // Each chunk of the draw list is recorded into a secondary buffer by whichever worker picks it up.
+            const auto& draws = snapshots[current].draws;
+            const auto thread_count = context.task_manager->handle().GetThreadCount();
+            const auto chunks = std::clamp<std::uint32_t>((draws.size() + draws_per_chunk - 1) / draws_per_chunk, 1, thread_count);
+            secondaries.resize(chunks);
+            context.task_manager->parallel_for(chunks, [&](std::uint32_t chunk) {
+                auto secondary = gfx::acquire_secondary(renderer, context, frame);
+                secondary
+                    .begin(render_pass, 0, frame.image_idx)
+                    .set_viewport(meta::full_viewport)
+                    .set_scissor(meta::full_scissor)
+                    .bind_pipeline(pipeline)
+                    .bind_descriptor_set(set[frame.index], dynamic_offsets);
+                for (auto i = draws.size() * chunk / chunks; i < draws.size() * (chunk + 1) / chunks; ++i) {
+                    const auto& [geometry, indices, index_count, constants] = draws[i];
+                    secondary
+                        .bind_static_mesh(geometry, indices)
+                        .push_constants(VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, sizeof(DrawConstants), &constants)
+                        .draw_indexed(index_count, 1, 0, 0);
+                }
+                secondary.end();
+                secondaries[chunk] = secondary;
+            });
+
+            command_buffer
+                    .begin_render_pass(render_pass, frame.image_idx, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+                    .execute(secondaries);
 
-        command_buffer
-                .end_render_pass()
-                .insert_layout_transition({
-                    .image = frame.image,
-                    .mip = 0,
-                    .levels = 0,
-                    .source_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-                    .dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
-                    .source_access = {},
-                    .dest_access = VK_ACCESS_TRANSFER_WRITE_BIT,
-                    .old_layout = VK_IMAGE_LAYOUT_UNDEFINED,
-                    .new_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-                })
-                .copy_image(render_pass.image(0), *frame.image)
-                .insert_layout_transition({
-                    .image = frame.image,
-                    .mip = 0,
-                    .levels = 0,
-                    .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
-                    .dest_stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
-                    .source_access = VK_ACCESS_TRANSFER_WRITE_BIT,
-                    .dest_access = {},
-                    .old_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                    .new_layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
-                })
-            .end();
+            command_buffer
+                    .end_render_pass()
+                .end();
+        },
+        .pinned = false
+    } });
+
+    const auto sample_input = [&]() {
+        return headless ? Camera::Input{} : Camera::Input::sample(window);
+    };
+
+    // The first snapshot has nothing to overlap with.
+    input = sample_input();
+    simulation.run(context);
+    std::swap(current, next);
+
+    const auto start_time = gfx::get_time();
+    while (headless ? frame_count < headless_frames : !window.should_close()) {
+        std::tie(command_buffer, frame) = gfx::acquire_next_frame(renderer, context);
+        ++frame_count;
+
+        const auto current_frame = gfx::get_time();
+        delta_time = current_frame - last_frame;
+        last_frame = current_frame;
+
+        input = sample_input();
+        simulation.launch(context);
+        rendering.run(context);
+        simulation.wait(context);
 
         gfx::present_frame(renderer, context, command_buffer, frame, render_pass.sync_stage());
         gfx::poll_transfers(context);
-        window.poll_events();
-        camera.update(window, delta_time);
+        qz_likely_if(!headless) {
+            window.poll_events();
+        }
+        std::swap(current, next);
     }
-
     context.graphics->wait_idle();
+    qz_unlikely_if(headless) {
+        const auto elapsed = gfx::get_time() - start_time;
+        std::printf("%zu frames in %.3f s, %.3f ms per frame\n", frame_count, elapsed, elapsed * 1000.0 / frame_count);
+    }
+
     assets::free_all_resources(context);
 
     gfx::DescriptorSet<>::destroy(context, set);
-    gfx::Buffer<>::destroy(context, model_buf);
-    gfx::Buffer<>::destroy(context, camera_buf);
+    gfx::TransformStore::destroy(context, transform_store);
     gfx::Pipeline::destroy(context, pipeline);
     gfx::RenderPass::destroy(context, render_pass);
 
     gfx::Renderer::destroy(context, renderer);
     gfx::Context::destroy(context);
-    gfx::Window::destroy(window);
-    gfx::Window::terminate();
+    qz_likely_if(!headless) {
+        gfx::Window::destroy(window);
+        gfx::Window::terminate();
+    }
     return 0;
 }
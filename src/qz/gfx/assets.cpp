@@ -1,3 +1,4 @@
+#include <qz/gfx/texture_streamer.hpp>
 #include <qz/gfx/static_texture.hpp>
 #include <qz/gfx/static_model.hpp>
 #include <qz/gfx/static_mesh.hpp>
@@ -57,19 +58,23 @@ namespace qz::assets {
     }
 
     void free_all_resources(const gfx::Context& context) noexcept {
-        context.transfer->wait_idle();
+        context.transfer_scheduler->wait_idle(context);
         while (!all_ready<gfx::StaticMesh>()) {
             using namespace std::literals;
             std::this_thread::sleep_for(100ms);
+            // Meshes only become ready once their batched upload is flushed and polled.
+            gfx::poll_transfers(context);
         }
         for (auto& [mesh, _] : assets<gfx::StaticMesh>) {
             gfx::StaticMesh::destroy(context, mesh);
         }
         assets<gfx::StaticMesh>.clear();
 
-        while (!all_ready<gfx::StaticTexture>()) {
+        while (!all_ready<gfx::StaticTexture>() || context.streamer->pending() != 0) {
             using namespace std::literals;
             std::this_thread::sleep_for(100ms);
+            // Packed textures only become ready once their atlas upload is flushed and polled.
+            gfx::poll_transfers(context);
         }
         for (auto& [texture, _] : assets<gfx::StaticTexture>) {
             gfx::StaticTexture::destroy(context, texture);
@@ -1,7 +1,7 @@
 #include <qz/gfx/buffer.hpp>
 
+#include <algorithm>
 #include <cstring>
-#include <string>
 
 namespace qz::gfx {
     qz_nodiscard Buffer<1> Buffer<1>::from_raw(StaticBuffer&& handle, std::size_t size) noexcept {
@@ -25,18 +25,17 @@ namespace qz::gfx {
         }), size);
     }
 
+    // Grows geometrically and keeps what was written so far, anything past it was never valid to read.
     void Buffer<1>::resize(const Context& context, Buffer<1>& buffer, std::size_t size) noexcept {
         if (size > buffer.capacity()) {
-            const auto flags = buffer._handle.flags;
-            std::string temp(size, '\0');
-            std::memcpy(temp.data(), buffer.view(), size);
-            StaticBuffer::destroy(context, buffer._handle);
-            buffer._handle = StaticBuffer::create(context, {
-                .flags = flags,
+            auto handle = StaticBuffer::create(context, {
+                .flags = buffer._handle.flags,
                 .usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
-                .capacity = size
+                .capacity = std::max(size, buffer.capacity() * 2)
             });
-            buffer.write(temp.data(), size);
+            std::memcpy(handle.mapped, buffer.view(), buffer._size);
+            StaticBuffer::destroy(context, buffer._handle);
+            buffer._handle = handle;
         }
     }
 
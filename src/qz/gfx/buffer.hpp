@@ -11,7 +11,7 @@
 #include <vulkan/vulkan.h>
 
 namespace qz::gfx {
-    template <std::size_t = meta::in_flight>
+    template <std::size_t = meta::max_in_flight>
     class Buffer;
 
     template <>
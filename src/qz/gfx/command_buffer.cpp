@@ -8,6 +8,8 @@
 #include <qz/gfx/assets.hpp>
 #include <qz/gfx/queue.hpp>
 
+#include <vector>
+
 namespace qz::gfx {
     qz_nodiscard CommandBuffer CommandBuffer::from_raw(VkCommandPool pool, VkCommandBuffer handle) noexcept {
         CommandBuffer result{};
@@ -16,12 +18,12 @@ namespace qz::gfx {
         return result;
     }
 
-    qz_nodiscard CommandBuffer CommandBuffer::allocate(const Context& context, VkCommandPool pool) noexcept {
+    qz_nodiscard CommandBuffer CommandBuffer::allocate(const Context& context, VkCommandPool pool, VkCommandBufferLevel level) noexcept {
         VkCommandBuffer handle;
         VkCommandBufferAllocateInfo allocate_info{};
         allocate_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         allocate_info.commandPool = pool;
-        allocate_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocate_info.level = level;
         allocate_info.commandBufferCount = 1;
         qz_vulkan_check(vkAllocateCommandBuffers(context.device, &allocate_info, &handle));
 
@@ -41,7 +43,27 @@ namespace qz::gfx {
         return *this;
     }
 
-    CommandBuffer& CommandBuffer::begin_render_pass(const RenderPass& render_pass, std::size_t framebuffer) noexcept {
+    // Secondary buffers recorded entirely inside a subpass of a render pass begun by a primary buffer.
+    CommandBuffer& CommandBuffer::begin(const RenderPass& render_pass, std::uint32_t subpass, std::size_t framebuffer) noexcept {
+        _active_pass = &render_pass;
+
+        VkCommandBufferInheritanceInfo inheritance_info{};
+        inheritance_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance_info.renderPass = render_pass.handle();
+        inheritance_info.subpass = subpass;
+        inheritance_info.framebuffer = render_pass.framebuffer(framebuffer);
+
+        VkCommandBufferBeginInfo begin_info{};
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags =
+            VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT |
+            VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        begin_info.pInheritanceInfo = &inheritance_info;
+        qz_vulkan_check(vkBeginCommandBuffer(_handle, &begin_info));
+        return *this;
+    }
+
+    CommandBuffer& CommandBuffer::begin_render_pass(const RenderPass& render_pass, std::size_t framebuffer, VkSubpassContents contents) noexcept {
         _active_pass = &render_pass;
         const auto clear_values = render_pass.clears();
 
@@ -52,7 +74,7 @@ namespace qz::gfx {
         begin_info.renderArea.extent = render_pass.extent();
         begin_info.clearValueCount = clear_values.size();
         begin_info.pClearValues = clear_values.data();
-        vkCmdBeginRenderPass(_handle, &begin_info, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(_handle, &begin_info, contents);
         return *this;
     }
 
@@ -86,13 +108,13 @@ namespace qz::gfx {
     }
 
     CommandBuffer& CommandBuffer::bind_pipeline(const Pipeline& pipeline) noexcept {
-        vkCmdBindPipeline(_handle, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.handle());
+        vkCmdBindPipeline(_handle, pipeline.bind_point(), pipeline.handle());
         _active_pipeline = &pipeline;
         return *this;
     }
 
-    CommandBuffer& CommandBuffer::bind_descriptor_set(const DescriptorSet<1>& set) noexcept {
-        vkCmdBindDescriptorSets(_handle, VK_PIPELINE_BIND_POINT_GRAPHICS, _active_pipeline->layout(), 0, 1, set.ptr_handle(), 0, nullptr);
+    CommandBuffer& CommandBuffer::bind_descriptor_set(const DescriptorSet<1>& set, std::span<const std::uint32_t> offsets) noexcept {
+        vkCmdBindDescriptorSets(_handle, _active_pipeline->bind_point(), _active_pipeline->layout(), 0, 1, set.ptr_handle(), offsets.size(), offsets.data());
         return *this;
     }
 
@@ -111,14 +133,21 @@ namespace qz::gfx {
         _ready = false;
         const auto lock = assets::acquire<StaticMesh>();
         qz_likely_if(assets::is_ready(handle)) {
-            const auto mesh = assets::from_handle(handle);
-            bind_vertex_buffer(mesh.geometry);
-            bind_index_buffer(mesh.indices);
-            _ready = true;
+            const auto& mesh = assets::from_handle(handle);
+            bind_static_mesh(mesh.geometry.handle, mesh.indices.handle);
         }
         return *this;
     }
 
+    // Binds buffers resolved beforehand, without going through the mesh storage's lock.
+    CommandBuffer& CommandBuffer::bind_static_mesh(VkBuffer geometry, VkBuffer indices) noexcept {
+        VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(_handle, 0, 1, &geometry, &offset);
+        vkCmdBindIndexBuffer(_handle, indices, 0, VK_INDEX_TYPE_UINT32);
+        _ready = true;
+        return *this;
+    }
+
     CommandBuffer& CommandBuffer::push_constants(VkPipelineStageFlags flags, std::size_t size, const void* data) noexcept {
         vkCmdPushConstants(_handle, _active_pipeline->layout(), flags, 0, size, data);
         return *this;
@@ -144,6 +173,11 @@ namespace qz::gfx {
         return *this;
     }
 
+    CommandBuffer& CommandBuffer::dispatch(std::uint32_t x, std::uint32_t y, std::uint32_t z) noexcept {
+        vkCmdDispatch(_handle, x, y, z);
+        return *this;
+    }
+
     CommandBuffer& CommandBuffer::end_render_pass() noexcept {
         _active_pipeline = nullptr;
         _active_pass = nullptr;
@@ -151,6 +185,18 @@ namespace qz::gfx {
         return *this;
     }
 
+    CommandBuffer& CommandBuffer::execute(std::span<const CommandBuffer> secondaries) noexcept {
+        std::vector<VkCommandBuffer> handles;
+        handles.reserve(secondaries.size());
+        for (const auto& each : secondaries) {
+            handles.emplace_back(each._handle);
+        }
+        qz_likely_if(!handles.empty()) {
+            vkCmdExecuteCommands(_handle, handles.size(), handles.data());
+        }
+        return *this;
+    }
+
     CommandBuffer& CommandBuffer::copy_image(const Image& source, const Image& dest) noexcept {
         VkImageCopy region{};
         region.srcSubresource = {
@@ -210,6 +256,15 @@ namespace qz::gfx {
         return *this;
     }
 
+    CommandBuffer& CommandBuffer::copy_buffer(const StaticBuffer& source, const StaticBuffer& dest, std::size_t offset, std::size_t size) noexcept {
+        VkBufferCopy region{};
+        region.size = size;
+        region.srcOffset = offset;
+        region.dstOffset = 0;
+        vkCmdCopyBuffer(_handle, source.handle, dest.handle, 1, &region);
+        return *this;
+    }
+
     CommandBuffer& CommandBuffer::copy_buffer_to_image(const StaticBuffer& source, const Image& dest) noexcept {
         VkBufferImageCopy region{};
         region.bufferOffset = 0;
@@ -225,6 +280,26 @@ namespace qz::gfx {
         return *this;
     }
 
+    CommandBuffer& CommandBuffer::copy_buffer_to_image(const StaticBuffer& source, const Image& dest, std::span<const BufferImageCopy> copies) noexcept {
+        std::vector<VkBufferImageCopy> regions;
+        regions.reserve(copies.size());
+        for (const auto& copy : copies) {
+            VkBufferImageCopy region{};
+            region.bufferOffset = copy.source_off;
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+            region.imageSubresource.aspectMask = dest.aspect;
+            region.imageSubresource.mipLevel = copy.dest_mip;
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageOffset = { copy.dest_off.x, copy.dest_off.y, 0 };
+            region.imageExtent = { copy.extent.width, copy.extent.height, 1 };
+            regions.emplace_back(region);
+        }
+        vkCmdCopyBufferToImage(_handle, source.handle, dest.handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regions.size(), regions.data());
+        return *this;
+    }
+
     CommandBuffer& CommandBuffer::transfer_ownership(const BufferMemoryBarrier& info, const Queue& source, const Queue& dest) noexcept {
         VkBufferMemoryBarrier barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
@@ -302,6 +377,27 @@ namespace qz::gfx {
         return *this;
     }
 
+    CommandBuffer& CommandBuffer::insert_buffer_barrier(const BufferMemoryBarrier& info) noexcept {
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = info.source_access;
+        barrier.dstAccessMask = info.dest_access;
+        barrier.srcQueueFamilyIndex = meta::family_ignored;
+        barrier.dstQueueFamilyIndex = meta::family_ignored;
+        barrier.buffer = info.buffer->handle;
+        barrier.offset = 0;
+        barrier.size = info.buffer->capacity;
+        vkCmdPipelineBarrier(
+            _handle,
+            info.source_stage,
+            info.dest_stage,
+            VkDependencyFlags{},
+            0, nullptr,
+            1, &barrier,
+            0, nullptr);
+        return *this;
+    }
+
     void CommandBuffer::end() noexcept {
         qz_vulkan_check(vkEndCommandBuffer(_handle));
     }
@@ -313,4 +409,8 @@ namespace qz::gfx {
     qz_nodiscard const VkCommandBuffer* CommandBuffer::ptr_handle() const noexcept {
         return &_handle;
     }
+
+    qz_nodiscard VkCommandPool CommandBuffer::pool() const noexcept {
+        return _pool;
+    }
 } // namespace qz::gfx
\ No newline at end of file
@@ -8,6 +8,8 @@
 
 #include <vulkan/vulkan.h>
 
+#include <span>
+
 namespace qz::gfx {
     struct BufferMemoryBarrier {
         const StaticBuffer* buffer;
@@ -39,6 +41,13 @@ namespace qz::gfx {
 
     };
 
+    struct BufferImageCopy {
+        std::size_t source_off;
+        std::uint32_t dest_mip;
+        VkOffset2D dest_off;
+        VkExtent2D extent;
+    };
+
     class CommandBuffer {
         const RenderPass* _active_pass;
         const Pipeline* _active_pipeline;
@@ -48,34 +57,42 @@ namespace qz::gfx {
     public:
         qz_nodiscard CommandBuffer() noexcept = default;
         qz_nodiscard static CommandBuffer from_raw(VkCommandPool, VkCommandBuffer) noexcept;
-        qz_nodiscard static CommandBuffer allocate(const Context&, VkCommandPool) noexcept;
+        qz_nodiscard static CommandBuffer allocate(const Context&, VkCommandPool, VkCommandBufferLevel = VK_COMMAND_BUFFER_LEVEL_PRIMARY) noexcept;
         static void destroy(const Context&, CommandBuffer&) noexcept;
 
         CommandBuffer& begin() noexcept;
-        CommandBuffer& begin_render_pass(const RenderPass&, std::size_t) noexcept;
+        CommandBuffer& begin(const RenderPass&, std::uint32_t, std::size_t) noexcept;
+        CommandBuffer& begin_render_pass(const RenderPass&, std::size_t, VkSubpassContents = VK_SUBPASS_CONTENTS_INLINE) noexcept;
         CommandBuffer& set_viewport(meta::viewport_tag_t) noexcept;
         CommandBuffer& set_viewport(VkViewport) noexcept;
         CommandBuffer& set_scissor(meta::scissor_tag_t) noexcept;
         CommandBuffer& set_scissor(VkRect2D) noexcept;
         CommandBuffer& bind_pipeline(const Pipeline&) noexcept;
-        CommandBuffer& bind_descriptor_set(const DescriptorSet<1>&) noexcept;
+        CommandBuffer& bind_descriptor_set(const DescriptorSet<1>&, std::span<const std::uint32_t> = {}) noexcept;
         CommandBuffer& bind_vertex_buffer(const StaticBuffer&) noexcept;
         CommandBuffer& bind_index_buffer(const StaticBuffer&) noexcept;
         CommandBuffer& bind_static_mesh(meta::Handle<StaticMesh>) noexcept;
+        CommandBuffer& bind_static_mesh(VkBuffer, VkBuffer) noexcept;
         CommandBuffer& push_constants(VkPipelineStageFlags, std::size_t, const void*) noexcept;
         CommandBuffer& draw(std::uint32_t, std::uint32_t, std::uint32_t, std::uint32_t) noexcept;
         CommandBuffer& draw_indexed(std::uint32_t, std::uint32_t, std::uint32_t, std::uint32_t) noexcept;
+        CommandBuffer& dispatch(std::uint32_t, std::uint32_t, std::uint32_t) noexcept;
         CommandBuffer& end_render_pass() noexcept;
+        CommandBuffer& execute(std::span<const CommandBuffer>) noexcept;
         CommandBuffer& copy_image(const Image&, const Image&) noexcept;
         CommandBuffer& blit_image(const ImageBlit&) noexcept;
         CommandBuffer& copy_buffer(const StaticBuffer&, const StaticBuffer&) noexcept;
+        CommandBuffer& copy_buffer(const StaticBuffer&, const StaticBuffer&, std::size_t, std::size_t) noexcept;
         CommandBuffer& copy_buffer_to_image(const StaticBuffer&, const Image&) noexcept;
+        CommandBuffer& copy_buffer_to_image(const StaticBuffer&, const Image&, std::span<const BufferImageCopy>) noexcept;
         CommandBuffer& transfer_ownership(const BufferMemoryBarrier&, const Queue&, const Queue&) noexcept;
         CommandBuffer& transfer_ownership(const ImageMemoryBarrier&, const Queue&, const Queue&) noexcept;
         CommandBuffer& insert_layout_transition(const ImageMemoryBarrier&) noexcept;
+        CommandBuffer& insert_buffer_barrier(const BufferMemoryBarrier&) noexcept;
         void end() noexcept;
 
         qz_nodiscard VkCommandBuffer handle() const noexcept;
         qz_nodiscard const VkCommandBuffer* ptr_handle() const noexcept;
+        qz_nodiscard VkCommandPool pool() const noexcept;
     };
 } // namespace qz::gfx
\ No newline at end of file
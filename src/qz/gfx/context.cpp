@@ -2,11 +2,13 @@
 #include <qz/gfx/window.hpp>
 #include <qz/gfx/queue.hpp>
 
+#include <qz/meta/constants.hpp>
+
 #include <GLFW/glfw3.h>
 
 #include <algorithm>
 #include <cstring>
-#include <thread>
+#include <cstdio>
 #include <array>
 
 namespace qz::gfx {
@@ -70,16 +72,29 @@ namespace qz::gfx {
         });
     }
 
-    qz_nodiscard static bool is_graphics_card_suitable(VkPhysicalDevice gpu) noexcept {
-        // Query for card's available properties and features
+    // Ranks a graphics card by its type, discrete cards first, zero if it can't render at all.
+    qz_nodiscard static std::uint32_t rank_graphics_card(VkPhysicalDevice gpu) noexcept {
+        // Query for card's available properties and queue families
         VkPhysicalDeviceProperties properties;
         vkGetPhysicalDeviceProperties(gpu, &properties);
 
-        VkPhysicalDeviceFeatures features;
-        vkGetPhysicalDeviceFeatures(gpu, &features);
+        std::uint32_t families_count;
+        vkGetPhysicalDeviceQueueFamilyProperties(gpu, &families_count, nullptr);
+        std::vector<VkQueueFamilyProperties> families(families_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(gpu, &families_count, families.data());
+        if (std::none_of(families.begin(), families.end(), [](const auto& family) noexcept {
+            return family.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+        })) {
+            return 0;
+        }
 
-        // Device is suitable if it's a discrete graphics card
-        return properties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU;
+        switch (properties.deviceType) {
+            case VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU:   return 5;
+            case VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU: return 4;
+            case VK_PHYSICAL_DEVICE_TYPE_VIRTUAL_GPU:    return 3;
+            case VK_PHYSICAL_DEVICE_TYPE_CPU:            return 2;
+            default:                                     return 1;
+        }
     }
 
     qz_nodiscard Context Context::create(const Settings& settings) noexcept {
@@ -94,12 +109,17 @@ namespace qz::gfx {
         application_info.engineVersion = settings.version;
         application_info.apiVersion = settings.version;
 
-        qz_assert(glfwInit(), "GLFW failed to initialize, or was not initialized correctly");
-        std::uint32_t required_count;
-        const char** required_extensions = glfwGetRequiredInstanceExtensions(&required_count);
-
+        // Headless contexts never present, they need neither GLFW nor its surface extensions.
+        context.headless = settings.headless;
+        context.frames_in_flight = clamp_frames_in_flight(settings.frames_in_flight);
         std::vector<const char*> instance_layers;
-        std::vector<const char*> instance_extensions(required_extensions, required_extensions + required_count);
+        std::vector<const char*> instance_extensions;
+        if (!settings.headless) {
+            qz_assert(glfwInit(), "GLFW failed to initialize, or was not initialized correctly");
+            std::uint32_t required_count;
+            const char** required_extensions = glfwGetRequiredInstanceExtensions(&required_count);
+            instance_extensions.assign(required_extensions, required_extensions + required_count);
+        }
 #if defined(quartz_debug)
         instance_extensions.emplace_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
         instance_layers.emplace_back("VK_LAYER_KHRONOS_validation");
@@ -184,11 +204,11 @@ namespace qz::gfx {
         std::vector<VkPhysicalDevice> graphics_cards(gpu_count);
         qz_vulkan_check(vkEnumeratePhysicalDevices(context.instance, &gpu_count, graphics_cards.data()));
 
-        // Select graphics card
-        for (const auto gpu : graphics_cards) {
-            if (is_graphics_card_suitable(gpu)) {
+        // Select the highest ranked graphics card, integrated and CPU implementations are still accepted.
+        for (std::uint32_t best = 0; const auto gpu : graphics_cards) {
+            if (const auto rank = rank_graphics_card(gpu); rank > best) {
                 context.gpu = gpu;
-                break;
+                best = rank;
             }
         }
         qz_assert(context.gpu, "failed to find a suitable graphics gard");
@@ -238,9 +258,10 @@ namespace qz::gfx {
         queue_create_info[1].queueCount = 1;
         queue_create_info[1].pQueuePriorities = &transfer_priority;
 
-        const std::vector<const char*> enabled_extensions{
-            VK_KHR_SWAPCHAIN_EXTENSION_NAME
-        };
+        std::vector<const char*> enabled_extensions;
+        if (!settings.headless) {
+            enabled_extensions.emplace_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        }
 
         qz_assert(query_extension_availability(context.gpu, enabled_extensions),
                   "One or more required device extensions are not available");
@@ -252,7 +273,13 @@ namespace qz::gfx {
         descriptor_indexing.descriptorBindingPartiallyBound = true;
         descriptor_indexing.runtimeDescriptorArray = true;
 
+        VkPhysicalDeviceTimelineSemaphoreFeatures timeline_semaphore{};
+        timeline_semaphore.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+        timeline_semaphore.timelineSemaphore = true;
+        descriptor_indexing.pNext = &timeline_semaphore;
+
         VkPhysicalDeviceFeatures device_features{};
+        device_features.fragmentStoresAndAtomics = true;
         device_features.geometryShader = true;
         device_features.samplerAnisotropy = true;
 
@@ -260,7 +287,8 @@ namespace qz::gfx {
         VkDeviceCreateInfo device_create_info{};
         device_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
         device_create_info.pNext = &descriptor_indexing;
-        device_create_info.queueCreateInfoCount = queue_create_info.size();
+        // Families must be unique, without a dedicated transfer family both queues are the same one.
+        device_create_info.queueCreateInfoCount = transfer_family == graphics_family ? 1 : queue_create_info.size();
         device_create_info.pQueueCreateInfos = queue_create_info.data();
         device_create_info.enabledLayerCount = 0;
         device_create_info.ppEnabledLayerNames = nullptr;
@@ -269,9 +297,9 @@ namespace qz::gfx {
         device_create_info.pEnabledFeatures = &device_features;
         qz_vulkan_check(vkCreateDevice(context.gpu, &device_create_info, nullptr, &context.device));
 
-        // And create queues.
+        // And create queues, uploads only submit to the transfer queue if its family is a different one.
         context.graphics = Queue::create(context, graphics_family, 0);
-        context.transfer = Queue::create(context, transfer_family, 0);
+        context.transfer = transfer_family == graphics_family ? context.graphics : Queue::create(context, transfer_family, 0);
 
         // Create VmaAllocator.
         VmaAllocatorCreateInfo allocator_create_info{};
@@ -288,8 +316,35 @@ namespace qz::gfx {
         allocator_create_info.vulkanApiVersion = VK_API_VERSION_1_2;
         qz_vulkan_check(vmaCreateAllocator(&allocator_create_info, &context.allocator));
 
-        // Initialize FTL scheduler
-        context.task_manager = std::make_unique<TaskManager>();
+        // Meshes are written in place when device local memory is host visible, either unified memory or a resizable BAR.
+        // Without resizable BAR only a 256MB window is visible, too small to hold meshes.
+        VmaAllocationCreateInfo direct_create_info{};
+        direct_create_info.requiredFlags = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        std::uint32_t direct_type;
+        if (vmaFindMemoryTypeIndex(context.allocator, ~0u, &direct_create_info, &direct_type) == VK_SUCCESS) {
+            const VkPhysicalDeviceMemoryProperties* memory_properties;
+            vmaGetMemoryProperties(context.allocator, &memory_properties);
+            const auto heap = memory_properties->memoryTypes[direct_type].heapIndex;
+            context.direct_uploads = memory_properties->memoryHeaps[heap].size > (256ull << 20);
+        }
+
+        // Initialize FTL scheduler and the threads blocking reads are handed to.
+        context.task_manager = std::make_unique<TaskManager>(settings);
+        context.io = IoPool::create(context, settings);
+
+        // Create staging ring shared by all uploads, the batcher recording them once per tick and the thread submitting them.
+        context.staging = StagingRing::create(context, settings);
+        context.uploads = UploadBatcher::create(context, settings);
+        context.transfer_scheduler = TransferScheduler::create(context);
+
+        // Create per frame allocator for transient uniform and storage data.
+        context.frame_allocator = FrameAllocator::create(context, settings);
+
+        // Create deferred deletion queue, texture streamer, virtual texture cache and texture atlas.
+        context.deletion_queue = std::make_unique<DeletionQueue>();
+        context.streamer = TextureStreamer::create(context, settings);
+        context.virtual_textures = VirtualTextureCache::create(context, settings);
+        context.atlas = TextureAtlas::create(context, settings);
 
         // Create main command pool, used for allocating rendering command buffers.
         VkCommandPoolCreateInfo pool_create_info{};
@@ -298,26 +353,21 @@ namespace qz::gfx {
         pool_create_info.queueFamilyIndex = context.graphics->family();
         vkCreateCommandPool(context.device, &pool_create_info, nullptr, &context.main_pool);
 
-        // Create dedicated transfer pools for each thread.
-        const auto thread_count = std::thread::hardware_concurrency();
+        // Create recycling transfer and graphics pools for each scheduler thread, the main thread included.
+        const auto thread_count = context.task_manager->handle().GetThreadCount();
         context.transfer_pools.reserve(thread_count);
-        pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
-        pool_create_info.queueFamilyIndex = context.transfer->family();
-        for (std::size_t i = 0; i < thread_count; ++i) {
-            vkCreateCommandPool(context.device, &pool_create_info, nullptr, &context.transfer_pools.emplace_back());
-        }
-
-        // Create dedicated graphics pools for each thread.
-        pool_create_info.queueFamilyIndex = context.graphics->family();
         context.transient_pools.reserve(thread_count);
         for (std::size_t i = 0; i < thread_count; ++i) {
-            vkCreateCommandPool(context.device, &pool_create_info, nullptr, &context.transient_pools.emplace_back());
+            context.transfer_pools.emplace_back(RecyclingPool::create(context, context.transfer->family()));
+            context.transient_pools.emplace_back(RecyclingPool::create(context, context.graphics->family()));
         }
 
         // Create main descriptor set pool, used for allocating all our descriptor sets.
-        constexpr std::array<VkDescriptorPoolSize, 3> descriptor_sizes = { {
+        constexpr std::array<VkDescriptorPoolSize, 5> descriptor_sizes = { {
             { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         1024 },
             { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         1024 },
+            { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1024 },
+            { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1024 },
             { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4096 },
         } };
 
@@ -354,13 +404,22 @@ namespace qz::gfx {
     }
 
     void Context::destroy(Context& context) noexcept {
+        IoPool::destroy(context, *context.io);
+        context.deletion_queue->flush(context);
+        TextureAtlas::destroy(context, *context.atlas);
+        VirtualTextureCache::destroy(context, *context.virtual_textures);
+        TextureStreamer::destroy(context, *context.streamer);
+        FrameAllocator::destroy(context, *context.frame_allocator);
+        TransferScheduler::destroy(context, *context.transfer_scheduler);
+        UploadBatcher::destroy(context, *context.uploads);
+        StagingRing::destroy(context, *context.staging);
         vkDestroySampler(context.device, context.default_sampler, nullptr);
         vkDestroyCommandPool(context.device, context.main_pool, nullptr);
-        for (auto pool : context.transient_pools) {
-            vkDestroyCommandPool(context.device, pool, nullptr);
+        for (auto& pool : context.transient_pools) {
+            RecyclingPool::destroy(context, *pool);
         }
-        for (auto pool : context.transfer_pools) {
-            vkDestroyCommandPool(context.device, pool, nullptr);
+        for (auto& pool : context.transfer_pools) {
+            RecyclingPool::destroy(context, *pool);
         }
         vkDestroyDescriptorPool(context.device, context.descriptor_pool, nullptr);
         vmaDestroyAllocator(context.allocator);
@@ -373,7 +432,18 @@ namespace qz::gfx {
         context = {};
     }
 
+    // Frame slots are allocated up front, counts they can't hold are clamped rather than trusted.
+    qz_nodiscard std::uint32_t clamp_frames_in_flight(std::uint32_t count) noexcept {
+        const auto clamped = std::clamp(count, 1u, meta::max_in_flight);
+        qz_unlikely_if(clamped != count) {
+            std::printf("Frames in flight clamped from %u to %u\n", count, clamped);
+        }
+        return clamped;
+    }
+
     void poll_transfers(const Context& context) noexcept {
+        context.uploads->flush(context);
+        context.atlas->flush(context);
         context.task_manager->tick();
     }
 } // namespace qz::gfx
\ No newline at end of file
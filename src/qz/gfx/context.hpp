@@ -1,6 +1,16 @@
 #pragma once
 
+#include <qz/gfx/virtual_texture.hpp>
+#include <qz/gfx/transfer_scheduler.hpp>
+#include <qz/gfx/texture_streamer.hpp>
+#include <qz/gfx/texture_atlas.hpp>
+#include <qz/gfx/staging_ring.hpp>
+#include <qz/gfx/recycling_pool.hpp>
+#include <qz/gfx/frame_allocator.hpp>
+#include <qz/gfx/deletion_queue.hpp>
+#include <qz/gfx/upload_batcher.hpp>
 #include <qz/gfx/task_manager.hpp>
+#include <qz/gfx/io_pool.hpp>
 
 #include <qz/util/macros.hpp>
 #include <qz/util/fwd.hpp>
@@ -15,6 +25,36 @@
 namespace qz::gfx {
     struct Settings {
         std::uint32_t version = VK_MAKE_VERSION(1, 2, 0);
+        // Size of the mip tail textures are first made resident with, finer mips are streamed in on demand.
+        std::uint32_t texture_tail = 64;
+        // Memory budget streamed textures are kept within.
+        std::size_t texture_budget = 256ull << 20;
+        // Pages per side of the physical atlas virtual textures are streamed into.
+        std::uint32_t virtual_atlas_pages = 16;
+        // Texels per side of a virtual texture page and of the filtering border around it, files must match.
+        std::uint32_t virtual_page_size = 128;
+        std::uint32_t virtual_page_border = 4;
+        // Diffuse textures up to this size are packed into shared atlas pages, zero disables packing.
+        std::uint32_t atlas_threshold = 256;
+        std::uint32_t atlas_size = 2048;
+        // Size of the persistently mapped staging ring all uploads go through.
+        std::size_t staging_size = 64ull << 20;
+        // Size of each frame slot's buffer per frame uniform and storage data is carved out of.
+        std::size_t frame_allocator_size = 8ull << 20;
+        // Upload work recorded per tick, in bytes and in milliseconds spent recording, zero lifts either limit.
+        std::size_t upload_budget = 32ull << 20;
+        float upload_time_budget = 2.0f;
+        // Fiber workers for decoding and per frame work, zero uses one per hardware thread.
+        std::uint32_t worker_threads = 0;
+        // Threads doing blocking reads, kept off the fiber workers.
+        std::uint32_t io_threads = 2;
+        // Cores each pool may run on as a bitmask, zero leaves it to the OS.
+        std::uint64_t worker_affinity = 0;
+        std::uint64_t io_affinity = 0;
+        // Frames the CPU may record ahead of the GPU, one for latency up to meta::max_in_flight for throughput.
+        std::uint32_t frames_in_flight = 2;
+        // Skips GLFW and surfaces entirely, frames are rendered into a ring of offscreen images.
+        bool headless = false;
         // TODO: Maybe more settings?
     };
 
@@ -26,12 +66,25 @@ namespace qz::gfx {
         VkPhysicalDevice gpu;
         VkDevice device;
         VmaAllocator allocator;
+        bool direct_uploads;
+        bool headless;
+        std::uint32_t frames_in_flight;
         std::unique_ptr<TaskManager> task_manager;
-        std::unique_ptr<Queue> graphics;
-        std::unique_ptr<Queue> transfer;
+        std::unique_ptr<IoPool> io;
+        std::unique_ptr<StagingRing> staging;
+        std::unique_ptr<UploadBatcher> uploads;
+        std::unique_ptr<TransferScheduler> transfer_scheduler;
+        std::unique_ptr<FrameAllocator> frame_allocator;
+        std::unique_ptr<DeletionQueue> deletion_queue;
+        std::unique_ptr<TextureStreamer> streamer;
+        std::unique_ptr<VirtualTextureCache> virtual_textures;
+        std::unique_ptr<TextureAtlas> atlas;
+        // Without a dedicated transfer family both point to the same queue, submissions to it stay serialized.
+        std::shared_ptr<Queue> graphics;
+        std::shared_ptr<Queue> transfer;
         VkCommandPool main_pool;
-        std::vector<VkCommandPool> transfer_pools;
-        std::vector<VkCommandPool> transient_pools;
+        std::vector<std::unique_ptr<RecyclingPool>> transfer_pools;
+        std::vector<std::unique_ptr<RecyclingPool>> transient_pools;
         VkDescriptorPool descriptor_pool;
         VkSampler default_sampler;
 
@@ -40,4 +93,5 @@ namespace qz::gfx {
     };
 
     void poll_transfers(const Context&) noexcept;
+    qz_nodiscard std::uint32_t clamp_frames_in_flight(std::uint32_t) noexcept;
 } // namespace qz::gfx
\ No newline at end of file
@@ -0,0 +1,47 @@
+#include <qz/gfx/deletion_queue.hpp>
+#include <qz/gfx/context.hpp>
+
+#include <qz/meta/constants.hpp>
+
+#include <type_traits>
+#include <algorithm>
+
+namespace qz::gfx {
+    void DeletionQueue::push(const Image& image, std::function<void()>&& on_destroy) noexcept {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _entries.push_back({ image, std::move(on_destroy), meta::max_in_flight + 1 });
+    }
+
+    void DeletionQueue::push(const StaticBuffer& buffer) noexcept {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _entries.push_back({ buffer, {}, meta::max_in_flight + 1 });
+    }
+
+    static void destroy_resource(const Context& context, std::variant<Image, StaticBuffer>& resource, const std::function<void()>& on_destroy) noexcept {
+        std::visit([&context](auto& each) {
+            std::decay_t<decltype(each)>::destroy(context, each);
+        }, resource);
+        qz_unlikely_if(on_destroy) {
+            on_destroy();
+        }
+    }
+
+    void DeletionQueue::tick(const Context& context) noexcept {
+        std::lock_guard<std::mutex> lock(_mutex);
+        const auto expired = std::partition(_entries.begin(), _entries.end(), [](auto& each) {
+            return --each.frames != 0;
+        });
+        for (auto it = expired; it != _entries.end(); ++it) {
+            destroy_resource(context, it->resource, it->on_destroy);
+        }
+        _entries.erase(expired, _entries.end());
+    }
+
+    void DeletionQueue::flush(const Context& context) noexcept {
+        std::lock_guard<std::mutex> lock(_mutex);
+        for (auto& each : _entries) {
+            destroy_resource(context, each.resource, each.on_destroy);
+        }
+        _entries.clear();
+    }
+} // namespace qz::gfx
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <qz/gfx/static_buffer.hpp>
+#include <qz/gfx/image.hpp>
+
+#include <qz/util/macros.hpp>
+#include <qz/util/fwd.hpp>
+
+#include <functional>
+#include <variant>
+#include <cstdint>
+#include <vector>
+#include <mutex>
+
+namespace qz::gfx {
+    // Defers destruction of resources that may still be referenced by frames in flight.
+    class DeletionQueue {
+        struct Entry {
+            std::variant<Image, StaticBuffer> resource;
+            std::function<void()> on_destroy;
+            std::uint32_t frames;
+        };
+        std::vector<Entry> _entries;
+        std::mutex _mutex;
+    public:
+        void push(const Image&, std::function<void()>&& = {}) noexcept;
+        void push(const StaticBuffer&) noexcept;
+        void tick(const Context&) noexcept;
+        void flush(const Context&) noexcept;
+    };
+} // namespace qz::gfx
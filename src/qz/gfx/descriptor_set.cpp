@@ -54,7 +54,10 @@ namespace qz::gfx {
     }
 
     void DescriptorSet<1>::bind(const Context& context, DescriptorSet<1>& set, const DescriptorBinding& binding, const Buffer<1>& buffer) noexcept {
-        const auto descriptor = buffer.info();
+        bind(context, set, binding, buffer.info());
+    }
+
+    void DescriptorSet<1>::bind(const Context& context, DescriptorSet<1>& set, const DescriptorBinding& binding, VkDescriptorBufferInfo descriptor) noexcept {
         auto& bound = set._bound[binding];
         auto* current = std::get_if<0>(&bound);
 
@@ -14,7 +14,7 @@
 #include <vector>
 
 namespace qz::gfx {
-    template <std::size_t = meta::in_flight>
+    template <std::size_t = meta::max_in_flight>
     class DescriptorSet;
 
     template <>
@@ -30,6 +30,7 @@ namespace qz::gfx {
         static void destroy(const Context&, DescriptorSet<1>&) noexcept;
 
         static void bind(const Context&, DescriptorSet<1>&, const DescriptorBinding&, const Buffer<1>&) noexcept;
+        static void bind(const Context&, DescriptorSet<1>&, const DescriptorBinding&, VkDescriptorBufferInfo) noexcept;
         static void bind(const Context&, DescriptorSet<1>&, const DescriptorBinding&, meta::Handle<StaticTexture>) noexcept;
         static void bind(const Context&, DescriptorSet<1>&, const DescriptorBinding&, const std::vector<VkDescriptorImageInfo>&) noexcept;
         qz_nodiscard VkDescriptorSet handle() const noexcept;
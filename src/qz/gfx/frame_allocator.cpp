@@ -0,0 +1,67 @@
+#include <qz/gfx/frame_allocator.hpp>
+#include <qz/gfx/context.hpp>
+
+#include <qz/util/bump.hpp>
+
+#include <cstdlib>
+#include <cstdio>
+
+namespace qz::gfx {
+    qz_nodiscard std::unique_ptr<FrameAllocator> FrameAllocator::create(const Context& context, const Settings& settings) noexcept {
+        auto allocator = std::make_unique<FrameAllocator>();
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(context.gpu, &properties);
+        allocator->_uniform_alignment = properties.limits.minUniformBufferOffsetAlignment;
+        allocator->_storage_alignment = properties.limits.minStorageBufferOffsetAlignment;
+        // Coherent memory, so that nothing has to be flushed before submitting.
+        for (auto& buffer : allocator->_buffers) {
+            buffer = StaticBuffer::create(context, {
+                .flags = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                .usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+                .capacity = settings.frame_allocator_size,
+                .required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+            });
+        }
+        allocator->_head = 0;
+        allocator->_frame = 0;
+        return allocator;
+    }
+
+    void FrameAllocator::destroy(const Context& context, FrameAllocator& allocator) noexcept {
+        for (auto& buffer : allocator._buffers) {
+            StaticBuffer::destroy(context, buffer);
+        }
+    }
+
+    // Only called once the slot's fence was waited on, nothing the GPU reads is overwritten.
+    void FrameAllocator::begin(std::uint32_t frame) noexcept {
+        _frame = frame;
+        _head.store(0, std::memory_order_relaxed);
+    }
+
+    qz_nodiscard FrameAllocation FrameAllocator::allocate(std::size_t size, meta::BufferKind kind) noexcept {
+        const auto alignment = kind == meta::uniform_buffer ? _uniform_alignment : _storage_alignment;
+        const auto& buffer = _buffers[_frame];
+        const auto start = util::bump_allocate(_head, size, alignment, buffer.capacity);
+        // Callers have nowhere else to put the data, running out means frame_allocator_size is too small.
+        qz_unlikely_if(start == util::bump_exhausted) {
+            std::printf("Frame allocator exhausted: %zu bytes requested, %zu of %zu in use\n", size, used(), buffer.capacity);
+            std::abort();
+        }
+        return {
+            .buffer = buffer.handle,
+            .offset = (std::uint32_t)start,
+            .size = size,
+            .mapped = static_cast<char*>(buffer.mapped) + start
+        };
+    }
+
+    // Range every dynamic offset into the slot's buffer is bound with.
+    qz_nodiscard Buffer<1> FrameAllocator::buffer(std::size_t index, std::size_t range) const noexcept {
+        return Buffer<1>::from_raw(StaticBuffer(_buffers[index]), range);
+    }
+
+    qz_nodiscard std::size_t FrameAllocator::used() const noexcept {
+        return _head.load(std::memory_order_relaxed);
+    }
+} // namespace qz::gfx
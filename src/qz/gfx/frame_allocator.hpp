@@ -0,0 +1,43 @@
+#pragma once
+
+#include <qz/gfx/static_buffer.hpp>
+#include <qz/gfx/buffer.hpp>
+
+#include <qz/meta/constants.hpp>
+#include <qz/meta/types.hpp>
+
+#include <qz/util/macros.hpp>
+#include <qz/util/fwd.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <atomic>
+
+namespace qz::gfx {
+    struct FrameAllocation {
+        VkBuffer buffer;
+        std::uint32_t offset;
+        std::size_t size;
+        void* mapped;
+    };
+
+    // Per frame uniform and storage data, bump allocated out of a persistently mapped buffer per frame slot.
+    // Descriptors are written once against the slot's buffer, allocations are selected through dynamic offsets.
+    class FrameAllocator {
+        meta::in_flight_array_t<StaticBuffer> _buffers;
+        std::size_t _uniform_alignment;
+        std::size_t _storage_alignment;
+        std::atomic<std::size_t> _head;
+        std::uint32_t _frame;
+    public:
+        qz_nodiscard static std::unique_ptr<FrameAllocator> create(const Context&, const Settings&) noexcept;
+        static void destroy(const Context&, FrameAllocator&) noexcept;
+
+        void begin(std::uint32_t) noexcept;
+        qz_nodiscard FrameAllocation allocate(std::size_t, meta::BufferKind) noexcept;
+        qz_nodiscard Buffer<1> buffer(std::size_t, std::size_t) const noexcept;
+        qz_nodiscard std::size_t used() const noexcept;
+    };
+} // namespace qz::gfx
@@ -0,0 +1,151 @@
+#pragma once
+
+#include <qz/gfx/command_buffer.hpp>
+#include <qz/gfx/deletion_queue.hpp>
+#include <qz/gfx/static_buffer.hpp>
+#include <qz/gfx/context.hpp>
+
+#include <qz/util/macros.hpp>
+#include <qz/util/fwd.hpp>
+
+#include <vulkan/vulkan.h>
+#include <vk_mem_alloc.h>
+
+#include <type_traits>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+namespace qz::gfx {
+    // Elements stored in a buffer that grows geometrically. Host visible storage keeps its contents with a memcpy,
+    // device local storage with a copy recorded into the caller's command buffer. Outgrown buffers go through the
+    // deletion queue, frames in flight may still be reading them.
+    template <typename T>
+    class GpuVector {
+        static_assert(std::is_trivially_copyable_v<T>, "GpuVector elements are copied bytewise");
+        constexpr static auto min_capacity = 64u;
+
+        StaticBuffer _buffer;
+        VmaMemoryUsage _usage;
+        std::size_t _size;
+
+        qz_nodiscard StaticBuffer _allocate(const Context& context, std::size_t capacity) const noexcept {
+            return StaticBuffer::create(context, {
+                .flags = _buffer.flags,
+                .usage = _usage,
+                .capacity = capacity * sizeof(T)
+            });
+        }
+
+        qz_nodiscard std::size_t _grown(std::size_t count) const noexcept {
+            return std::max<std::size_t>(count, capacity() * 2);
+        }
+    public:
+        qz_nodiscard static GpuVector create(const Context& context, VkBufferUsageFlags flags, VmaMemoryUsage usage, std::size_t capacity = 0) noexcept {
+            GpuVector vector{};
+            vector._buffer.flags = flags | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+            vector._usage = usage;
+            vector._buffer = vector._allocate(context, std::max<std::size_t>(capacity, min_capacity));
+            vector._size = 0;
+            return vector;
+        }
+
+        static void destroy(const Context& context, GpuVector& vector) noexcept {
+            StaticBuffer::destroy(context, vector._buffer);
+            vector = {};
+        }
+
+        // Only host visible storage can grow without a command buffer.
+        void reserve(const Context& context, std::size_t count) noexcept {
+            qz_likely_if(count <= capacity()) {
+                return;
+            }
+            qz_assert(_buffer.mapped, "device local storage grows through a command buffer");
+            auto buffer = _allocate(context, _grown(count));
+            std::memcpy(buffer.mapped, _buffer.mapped, _size * sizeof(T));
+            context.deletion_queue->push(_buffer);
+            _buffer = buffer;
+        }
+
+        void reserve(const Context& context, CommandBuffer& command_buffer, std::size_t count) noexcept {
+            qz_likely_if(count <= capacity() || _buffer.mapped) {
+                reserve(context, count);
+                return;
+            }
+            auto buffer = _allocate(context, _grown(count));
+            qz_likely_if(_size) {
+                command_buffer
+                    .insert_buffer_barrier({
+                        .buffer = &_buffer,
+                        .source_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                        .dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                        .source_access = VK_ACCESS_MEMORY_WRITE_BIT,
+                        .dest_access = VK_ACCESS_TRANSFER_READ_BIT
+                    })
+                    .copy_buffer(_buffer, buffer, 0, _size * sizeof(T))
+                    .insert_buffer_barrier({
+                        .buffer = &buffer,
+                        .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                        .dest_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                        .source_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+                        .dest_access = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT
+                    });
+            }
+            context.deletion_queue->push(_buffer);
+            _buffer = buffer;
+        }
+
+        void resize(const Context& context, std::size_t count) noexcept {
+            reserve(context, count);
+            _size = count;
+        }
+
+        void resize(const Context& context, CommandBuffer& command_buffer, std::size_t count) noexcept {
+            reserve(context, command_buffer, count);
+            _size = count;
+        }
+
+        void push_back(const Context& context, const T& value) noexcept {
+            qz_assert(_buffer.mapped, "only host visible storage is written through push_back");
+            reserve(context, _size + 1);
+            std::memcpy(static_cast<T*>(_buffer.mapped) + _size++, &value, sizeof(T));
+        }
+
+        void clear() noexcept {
+            _size = 0;
+        }
+
+        qz_nodiscard T* data() noexcept {
+            return static_cast<T*>(_buffer.mapped);
+        }
+
+        qz_nodiscard const T* data() const noexcept {
+            return static_cast<const T*>(_buffer.mapped);
+        }
+
+        qz_nodiscard T& operator [](std::size_t index) noexcept {
+            return data()[index];
+        }
+
+        qz_nodiscard const T& operator [](std::size_t index) const noexcept {
+            return data()[index];
+        }
+
+        qz_nodiscard std::size_t size() const noexcept {
+            return _size;
+        }
+
+        qz_nodiscard std::size_t capacity() const noexcept {
+            return _buffer.capacity / sizeof(T);
+        }
+
+        qz_nodiscard const StaticBuffer& buffer() const noexcept {
+            return _buffer;
+        }
+
+        // Covers the whole capacity, so that descriptors only need rewriting after the vector grew.
+        qz_nodiscard VkDescriptorBufferInfo info() const noexcept {
+            return { _buffer.handle, 0, _buffer.capacity };
+        }
+    };
+} // namespace qz::gfx
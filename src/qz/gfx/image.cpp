@@ -61,12 +61,7 @@ namespace qz::gfx {
         view_create_info.image = image.handle;
         view_create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
         view_create_info.format = info.format;
-        view_create_info.components = {
-            VK_COMPONENT_SWIZZLE_IDENTITY,
-            VK_COMPONENT_SWIZZLE_IDENTITY,
-            VK_COMPONENT_SWIZZLE_IDENTITY,
-            VK_COMPONENT_SWIZZLE_IDENTITY
-        };
+        view_create_info.components = info.swizzle;
         view_create_info.subresourceRange.aspectMask = image.aspect;
         view_create_info.subresourceRange.baseMipLevel = 0;
         view_create_info.subresourceRange.levelCount = info.mips;
@@ -16,6 +16,7 @@ namespace qz::gfx {
             std::uint32_t mips;
             VkFormat format;
             VkImageUsageFlags usage;
+            VkComponentMapping swizzle;
         };
 
         VkImage handle;
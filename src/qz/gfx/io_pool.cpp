@@ -0,0 +1,76 @@
+#include <qz/gfx/task_manager.hpp>
+#include <qz/gfx/context.hpp>
+#include <qz/gfx/io_pool.hpp>
+
+#include <qz/util/affinity.hpp>
+
+#include <algorithm>
+#include <utility>
+#include <atomic>
+
+namespace qz::gfx {
+    qz_nodiscard std::unique_ptr<IoPool> IoPool::create(const Context&, const Settings& settings) noexcept {
+        auto pool = std::make_unique<IoPool>();
+        pool->_running = true;
+        const auto count = std::max(settings.io_threads, 1u);
+        pool->_threads.reserve(count);
+        for (std::uint32_t i = 0; i < count; ++i) {
+            pool->_threads.emplace_back([pool = pool.get(), affinity = settings.io_affinity]() {
+                util::set_thread_affinity(affinity);
+                pool->_run();
+            });
+        }
+        return pool;
+    }
+
+    void IoPool::destroy(const Context&, IoPool& pool) noexcept {
+        {
+            std::lock_guard<std::mutex> lock(pool._mutex);
+            pool._running = false;
+        }
+        pool._condition.notify_all();
+        for (auto& thread : pool._threads) {
+            thread.join();
+        }
+        pool._threads.clear();
+    }
+
+    void IoPool::post(std::function<void()>&& function) noexcept {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _queued.emplace_back(std::move(function));
+        }
+        _condition.notify_one();
+    }
+
+    // Counters may only be decremented from scheduler threads, completion is handed over through the main thread's tick.
+    void IoPool::run(const Context& context, ftl::TaskScheduler* scheduler, std::function<void()>&& function) noexcept {
+        auto done = std::make_shared<std::atomic<bool>>(false);
+        post([function = std::move(function), done]() {
+            function();
+            done->store(true, std::memory_order_release);
+        });
+        context.task_manager->wait(scheduler, [done]() {
+            return done->load(std::memory_order_acquire) ? VK_SUCCESS : VK_NOT_READY;
+        });
+    }
+
+    // Whatever is still queued when the pool is destroyed is run before its threads exit.
+    void IoPool::_run() noexcept {
+        while (true) {
+            std::function<void()> function;
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _condition.wait(lock, [this]() {
+                    return !_queued.empty() || !_running;
+                });
+                qz_unlikely_if(_queued.empty()) {
+                    return;
+                }
+                function = std::move(_queued.front());
+                _queued.pop_front();
+            }
+            function();
+        }
+    }
+} // namespace qz::gfx
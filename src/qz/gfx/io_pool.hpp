@@ -0,0 +1,34 @@
+#pragma once
+
+#include <qz/util/macros.hpp>
+#include <qz/util/fwd.hpp>
+
+#include <ftl/task_scheduler.h>
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <deque>
+#include <mutex>
+
+namespace qz::gfx {
+    // A few plain threads for blocking reads and page faults, so that disk waits never stall a fiber worker.
+    // Fibers hand their read over and are suspended until it's done, decoding stays on the fiber pool.
+    class IoPool {
+        std::deque<std::function<void()>> _queued;
+        std::vector<std::thread> _threads;
+        std::condition_variable _condition;
+        std::mutex _mutex;
+        bool _running;
+
+        void _run() noexcept;
+    public:
+        qz_nodiscard static std::unique_ptr<IoPool> create(const Context&, const Settings&) noexcept;
+        static void destroy(const Context&, IoPool&) noexcept;
+
+        void post(std::function<void()>&&) noexcept;
+        void run(const Context&, ftl::TaskScheduler*, std::function<void()>&&) noexcept;
+    };
+} // namespace qz::gfx
@@ -24,6 +24,75 @@ namespace qz::gfx {
         return spirv;
     }
 
+    // Descriptor set layouts are shared through the renderer's cache, the pipeline layout is owned by the pipeline.
+    qz_nodiscard static VkPipelineLayout create_layout(const Context& context,
+                                                       Renderer& renderer,
+                                                       const std::map<std::size_t, descriptor_layout_t>& descriptor_layout,
+                                                       const VkPushConstantRange& push_constant_range,
+                                                       descriptor_set_layouts_t& set_layouts) noexcept {
+        set_layouts.reserve(descriptor_layout.size());
+        for (const auto& [_, descriptors] : descriptor_layout) {
+            if (!renderer.layout_cache.contains(descriptors)) {
+                std::vector<VkDescriptorBindingFlags> flags;
+                flags.reserve(descriptors.size());
+                std::vector<VkDescriptorSetLayoutBinding> bindings;
+                bindings.reserve(descriptors.size());
+                for (const auto& binding : descriptors) {
+                    flags.emplace_back();
+                    if (binding.dynamic) {
+                        flags.back() =
+                            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                            VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
+                    }
+
+                    bindings.push_back({
+                        .binding = (std::uint32_t)binding.index,
+                        .descriptorType = binding.type,
+                        .descriptorCount = binding.count,
+                        .stageFlags = binding.stage,
+                        .pImmutableSamplers = nullptr
+                    });
+                }
+
+                VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags{};
+                binding_flags.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+                binding_flags.bindingCount = flags.size();
+                binding_flags.pBindingFlags = flags.data();
+
+                VkDescriptorSetLayoutCreateInfo create_info{};
+                create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+                create_info.pNext = &binding_flags;
+                create_info.flags = {};
+                create_info.bindingCount = bindings.size();
+                create_info.pBindings = bindings.data();
+                qz_vulkan_check(vkCreateDescriptorSetLayout(context.device, &create_info, nullptr, &renderer.layout_cache[descriptors]));
+            }
+            set_layouts.push_back({ renderer.layout_cache[descriptors], descriptors });
+        }
+
+        std::vector<VkDescriptorSetLayout> set_layout_handles;
+        set_layout_handles.reserve(set_layouts.size());
+        for (const auto& layout : set_layouts) {
+            set_layout_handles.emplace_back(layout.handle);
+        }
+
+        VkPipelineLayoutCreateInfo layout_create_info{};
+        layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layout_create_info.setLayoutCount = set_layout_handles.size();
+        layout_create_info.pSetLayouts = set_layout_handles.data();
+        if (push_constant_range.size == 0) {
+            layout_create_info.pushConstantRangeCount = 0;
+            layout_create_info.pPushConstantRanges = nullptr;
+        } else {
+            layout_create_info.pushConstantRangeCount = 1;
+            layout_create_info.pPushConstantRanges = &push_constant_range;
+        }
+
+        VkPipelineLayout layout;
+        qz_vulkan_check(vkCreatePipelineLayout(context.device, &layout_create_info, nullptr, &layout));
+        return layout;
+    }
+
     qz_nodiscard Pipeline Pipeline::create(const Context& context, Renderer& renderer, CreateInfo&& info) noexcept {
         VkPipelineShaderStageCreateInfo pipeline_stages[2] = {};
         pipeline_stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
@@ -146,7 +215,7 @@ namespace qz::gfx {
                 }
             }
 
-            for (const auto& storage_buffer : resources.uniform_buffers) {
+            for (const auto& storage_buffer : resources.storage_buffers) {
                 const auto set_idx = compiler.get_decoration(storage_buffer.id, spv::DecorationDescriptorSet);
                 const auto binding_idx = compiler.get_decoration(storage_buffer.id, spv::DecorationBinding);
                 auto& layout = descriptor_layout[set_idx];
@@ -194,6 +263,20 @@ namespace qz::gfx {
             }
         }
 
+        for (const auto& name : info.dynamic_offsets) {
+            auto& binding = descriptor_bindings.at(name);
+            binding.type = binding.type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER ?
+                VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC :
+                VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC;
+            for (auto& [_, descriptors] : descriptor_layout) {
+                for (auto& each : descriptors) {
+                    qz_unlikely_if(each.name == name) {
+                        each.type = binding.type;
+                    }
+                }
+            }
+        }
+
         VkVertexInputBindingDescription vertex_binding_description{};
         vertex_binding_description.binding = 0;
         vertex_binding_description.stride =
@@ -296,66 +379,7 @@ namespace qz::gfx {
         pipeline_dynamic_states.pDynamicStates = info.states.data();
 
         descriptor_set_layouts_t set_layouts{};
-        set_layouts.reserve(descriptor_layout.size());
-        for (const auto& [_, descriptors] : descriptor_layout) {
-            if (!renderer.layout_cache.contains(descriptors)) {
-                std::vector<VkDescriptorBindingFlags> flags;
-                flags.reserve(descriptors.size());
-                std::vector<VkDescriptorSetLayoutBinding> bindings;
-                bindings.reserve(descriptors.size());
-                for (const auto& binding : descriptors) {
-                    flags.emplace_back();
-                    if (binding.dynamic) {
-                        flags.back() =
-                            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
-                            VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
-                    }
-
-                    bindings.push_back({
-                        .binding = (std::uint32_t)binding.index,
-                        .descriptorType = binding.type,
-                        .descriptorCount = binding.count,
-                        .stageFlags = binding.stage,
-                        .pImmutableSamplers = nullptr
-                    });
-                }
-
-                VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags{};
-                binding_flags.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
-                binding_flags.bindingCount = flags.size();
-                binding_flags.pBindingFlags = flags.data();
-
-                VkDescriptorSetLayoutCreateInfo create_info{};
-                create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-                create_info.pNext = &binding_flags;
-                create_info.flags = {};
-                create_info.bindingCount = bindings.size();
-                create_info.pBindings = bindings.data();
-                qz_vulkan_check(vkCreateDescriptorSetLayout(context.device, &create_info, nullptr, &renderer.layout_cache[descriptors]));
-            }
-            set_layouts.push_back({ renderer.layout_cache[descriptors], descriptors });
-        }
-
-        std::vector<VkDescriptorSetLayout> set_layout_handles;
-        set_layout_handles.reserve(set_layouts.size());
-        for (const auto& layout : set_layouts) {
-            set_layout_handles.emplace_back(layout.handle);
-        }
-
-        VkPipelineLayoutCreateInfo layout_create_info{};
-        layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        layout_create_info.setLayoutCount = set_layout_handles.size();
-        layout_create_info.pSetLayouts = set_layout_handles.data();
-        if (push_constant_range.size == 0) {
-            layout_create_info.pushConstantRangeCount = 0;
-            layout_create_info.pPushConstantRanges = nullptr;
-        } else {
-            layout_create_info.pushConstantRangeCount = 1;
-            layout_create_info.pPushConstantRanges = &push_constant_range;
-        }
-
-        VkPipelineLayout layout;
-        qz_vulkan_check(vkCreatePipelineLayout(context.device, &layout_create_info, nullptr, &layout));
+        const auto layout = create_layout(context, renderer, descriptor_layout, push_constant_range, set_layouts);
 
         VkGraphicsPipelineCreateInfo pipeline_create_info{};
         pipeline_create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
@@ -382,8 +406,91 @@ namespace qz::gfx {
 
         Pipeline pipeline{};
         pipeline._handle = handle;
+        pipeline._layout = layout;
+        pipeline._bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS;
         pipeline._bindings = std::move(descriptor_bindings);
+        pipeline._descriptors = std::move(set_layouts);
+        return pipeline;
+    }
+
+    qz_nodiscard Pipeline Pipeline::create(const Context& context, Renderer& renderer, ComputeCreateInfo&& info) noexcept {
+        VkPipelineShaderStageCreateInfo pipeline_stage{};
+        pipeline_stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipeline_stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipeline_stage.pName = "main";
+
+        VkPushConstantRange push_constant_range{};
+        push_constant_range.offset = 0;
+
+        descriptor_bindings_t descriptor_bindings;
+        std::map<std::size_t, descriptor_layout_t> descriptor_layout;
+        { // Compute shader.
+            const auto binary = load_spirv_code(info.compute);
+            const auto compiler = spirv_cross::CompilerGLSL((const std::uint32_t*)binary.data(), binary.size() / sizeof(std::uint32_t));
+            const auto resources = compiler.get_shader_resources();
+
+            VkShaderModuleCreateInfo module_create_info{};
+            module_create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+            module_create_info.codeSize = binary.size();
+            module_create_info.pCode = (const uint32_t*)binary.data();
+            qz_vulkan_check(vkCreateShaderModule(context.device, &module_create_info, nullptr, &pipeline_stage.module));
+
+            for (const auto& uniform_buffer : resources.uniform_buffers) {
+                const auto set_idx = compiler.get_decoration(uniform_buffer.id, spv::DecorationDescriptorSet);
+                const auto binding_idx = compiler.get_decoration(uniform_buffer.id, spv::DecorationBinding);
+
+                descriptor_layout[set_idx].push_back(
+                    descriptor_bindings[uniform_buffer.name] = {
+                        .dynamic = false,
+                        .name    = uniform_buffer.name,
+                        .index   = binding_idx,
+                        .count   = 1,
+                        .type    = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+                        .stage   = VK_SHADER_STAGE_COMPUTE_BIT
+                    });
+            }
+
+            for (const auto& storage_buffer : resources.storage_buffers) {
+                const auto set_idx = compiler.get_decoration(storage_buffer.id, spv::DecorationDescriptorSet);
+                const auto binding_idx = compiler.get_decoration(storage_buffer.id, spv::DecorationBinding);
+
+                descriptor_layout[set_idx].push_back(
+                    descriptor_bindings[storage_buffer.name] = {
+                        .dynamic = false,
+                        .name    = storage_buffer.name,
+                        .index   = binding_idx,
+                        .count   = 1,
+                        .type    = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                        .stage   = VK_SHADER_STAGE_COMPUTE_BIT
+                    });
+            }
+
+            for (const auto& push_constant : resources.push_constant_buffers) {
+                const auto& type = compiler.get_type(push_constant.type_id);
+                push_constant_range.size = compiler.get_declared_struct_size(type);
+                push_constant_range.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+            }
+        }
+
+        descriptor_set_layouts_t set_layouts{};
+        const auto layout = create_layout(context, renderer, descriptor_layout, push_constant_range, set_layouts);
+
+        VkComputePipelineCreateInfo pipeline_create_info{};
+        pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipeline_create_info.stage = pipeline_stage;
+        pipeline_create_info.layout = layout;
+        pipeline_create_info.basePipelineHandle = nullptr;
+        pipeline_create_info.basePipelineIndex = -1;
+
+        VkPipeline handle;
+        qz_vulkan_check(vkCreateComputePipelines(context.device, nullptr, 1, &pipeline_create_info, nullptr, &handle));
+        vkDestroyShaderModule(context.device, pipeline_stage.module, nullptr);
+
+        Pipeline pipeline{};
+        pipeline._handle = handle;
         pipeline._layout = layout;
+        pipeline._bind_point = VK_PIPELINE_BIND_POINT_COMPUTE;
+        pipeline._bindings = std::move(descriptor_bindings);
         pipeline._descriptors = std::move(set_layouts);
         return pipeline;
     }
@@ -402,6 +509,10 @@ namespace qz::gfx {
         return _layout;
     }
 
+    qz_nodiscard VkPipelineBindPoint Pipeline::bind_point() const noexcept {
+        return _bind_point;
+    }
+
     const DescriptorSetLayout& Pipeline::set(std::size_t index) const noexcept {
         return _descriptors.at(index);
     }
@@ -43,6 +43,7 @@ namespace qz::gfx {
     private:
         VkPipeline _handle;
         VkPipelineLayout _layout;
+        VkPipelineBindPoint _bind_point;
         descriptor_bindings_t _bindings;
         descriptor_set_layouts_t _descriptors;
     public:
@@ -54,13 +55,21 @@ namespace qz::gfx {
             const RenderPass* render_pass;
             std::uint32_t subpass;
             bool depth;
+            // Buffers bound from the frame allocator, selected with a dynamic offset when binding the set.
+            std::vector<std::string> dynamic_offsets;
+        };
+
+        struct ComputeCreateInfo {
+            const char* compute;
         };
 
         qz_nodiscard static Pipeline create(const Context&, Renderer&, CreateInfo&&) noexcept;
+        qz_nodiscard static Pipeline create(const Context&, Renderer&, ComputeCreateInfo&&) noexcept;
         static void destroy(const Context&, Pipeline&) noexcept;
 
         qz_nodiscard VkPipeline handle() const noexcept;
         qz_nodiscard VkPipelineLayout layout() const noexcept;
+        qz_nodiscard VkPipelineBindPoint bind_point() const noexcept;
         qz_nodiscard const DescriptorSetLayout& set(std::size_t) const noexcept;
         qz_nodiscard const DescriptorBinding& operator [](std::string_view) const noexcept;
     };
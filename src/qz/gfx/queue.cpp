@@ -3,12 +3,24 @@
 #include <qz/gfx/context.hpp>
 #include <qz/gfx/queue.hpp>
 
+#include <vector>
+#include <thread>
+
 namespace qz::gfx {
+    constexpr auto queue_slots = 256ull;
+
     qz_nodiscard std::unique_ptr<Queue> Queue::create(const Context& context,
                                                        std::uint32_t family,
                                                        std::uint32_t index) noexcept {
         auto queue = std::make_unique<Queue>();
         queue->_family = family;
+        queue->_slots = std::make_unique<Slot[]>(queue_slots);
+        for (std::uint64_t i = 0; i < queue_slots; ++i) {
+            queue->_slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        queue->_enqueue = 0;
+        queue->_dequeue = 0;
+        queue->_flushing = false;
         vkGetDeviceQueue(context.device, family, index, &queue->_handle);
         return queue;
     }
@@ -18,22 +30,20 @@ namespace qz::gfx {
                        VkSemaphore wait,
                        VkSemaphore signal,
                        VkFence fence) noexcept {
-        VkSubmitInfo submit_info{};
-        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-        if (wait) {
-            submit_info.pWaitDstStageMask = &stage;
-            submit_info.waitSemaphoreCount = 1;
-            submit_info.pWaitSemaphores = &wait;
-        }
-        submit_info.commandBufferCount = 1;
-        submit_info.pCommandBuffers = commands.ptr_handle();
-        if (signal) {
-            submit_info.signalSemaphoreCount = 1;
-            submit_info.pSignalSemaphores = &signal;
-        }
+        _push({ commands.handle(), stage, wait, 0, signal, 0, fence });
+        _drain();
+    }
 
-        std::lock_guard<std::mutex> lock(_mutex);
-        qz_vulkan_check(vkQueueSubmit(_handle, 1, &submit_info, fence));
+    // Waits on and signals timeline semaphore values, either semaphore may be null.
+    void Queue::submit(const CommandBuffer& commands,
+                       VkPipelineStageFlags stage,
+                       VkSemaphore wait,
+                       std::uint64_t wait_value,
+                       VkSemaphore signal,
+                       std::uint64_t signal_value,
+                       VkFence fence) noexcept {
+        _push({ commands.handle(), stage, wait, wait_value, signal, signal_value, fence });
+        _drain();
     }
 
     void Queue::present(const Swapchain& swapchain, std::uint32_t image, VkSemaphore wait) noexcept {
@@ -49,16 +59,130 @@ namespace qz::gfx {
         present_info.pImageIndices = &image;
         present_info.pResults = &present_result;
 
-        std::lock_guard<std::mutex> lock(_mutex);
+        // The submission signalling the semaphore may still be queued, binary semaphores can't be waited on before that.
+        _lock();
+        _flush();
         qz_vulkan_check(vkQueuePresentKHR(_handle, &present_info));
         qz_vulkan_check(present_result);
+        _unlock();
     }
 
-    void Queue::wait_idle() const noexcept {
+    void Queue::wait_idle() noexcept {
+        _lock();
+        _flush();
         qz_vulkan_check(vkQueueWaitIdle(_handle));
+        _unlock();
     }
 
     qz_nodiscard std::uint32_t Queue::family() const noexcept {
         return _family;
     }
-} // namespace qz::gfx
\ No newline at end of file
+
+    // Claims the next free slot with a CAS on the enqueue position, a full ring is flushed before trying again.
+    void Queue::_push(const Submission& submission) noexcept {
+        auto position = _enqueue.load(std::memory_order_relaxed);
+        while (true) {
+            auto& slot = _slots[position % queue_slots];
+            const auto sequence = slot.sequence.load(std::memory_order_acquire);
+            qz_likely_if(sequence == position) {
+                qz_likely_if(_enqueue.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+                    slot.submission = submission;
+                    slot.sequence.store(position + 1);
+                    return;
+                }
+            } else if (sequence < position) {
+                _drain();
+                std::this_thread::yield();
+                position = _enqueue.load(std::memory_order_relaxed);
+            } else {
+                position = _enqueue.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    qz_nodiscard bool Queue::_pending() const noexcept {
+        const auto position = _dequeue.load(std::memory_order_relaxed);
+        return _slots[position % queue_slots].sequence.load() == position + 1;
+    }
+
+    // Issues everything pushed so far, only ever called by the thread holding the flush flag.
+    void Queue::_flush() noexcept {
+        // Submissions are copied out so their slots can be reused right away, everything stops at the first unwritten slot.
+        auto& submissions = _submissions;
+        submissions.clear();
+        auto position = _dequeue.load(std::memory_order_relaxed);
+        for (; submissions.size() < queue_slots; ++position) {
+            auto& slot = _slots[position % queue_slots];
+            qz_unlikely_if(slot.sequence.load(std::memory_order_acquire) != position + 1) {
+                break;
+            }
+            submissions.emplace_back(slot.submission);
+            slot.sequence.store(position + queue_slots, std::memory_order_release);
+        }
+        _dequeue.store(position, std::memory_order_relaxed);
+        qz_likely_if(submissions.empty()) {
+            return;
+        }
+
+        const auto count = submissions.size();
+        auto& timeline_infos = _timeline_infos;
+        auto& submit_infos = _submit_infos;
+        timeline_infos.assign(count, {});
+        submit_infos.assign(count, {});
+        for (std::size_t i = 0; i < count; ++i) {
+            auto* submission = &submissions[i];
+            auto& timeline_info = timeline_infos[i];
+            auto& submit_info = submit_infos[i];
+            timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+            submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submit_info.pNext = &timeline_info;
+            if (submission->wait) {
+                timeline_info.waitSemaphoreValueCount = 1;
+                timeline_info.pWaitSemaphoreValues = &submission->wait_value;
+                submit_info.pWaitDstStageMask = &submission->stage;
+                submit_info.waitSemaphoreCount = 1;
+                submit_info.pWaitSemaphores = &submission->wait;
+            }
+            submit_info.commandBufferCount = 1;
+            submit_info.pCommandBuffers = &submission->commands;
+            if (submission->signal) {
+                timeline_info.signalSemaphoreValueCount = 1;
+                timeline_info.pSignalSemaphoreValues = &submission->signal_value;
+                submit_info.signalSemaphoreCount = 1;
+                submit_info.pSignalSemaphores = &submission->signal;
+            }
+        }
+
+        // A batch only takes one fence, so batches are cut right after every fenced submission.
+        for (std::size_t first = 0, i = 0; i < count; ++i) {
+            const auto fence = submissions[i].fence;
+            qz_unlikely_if(fence || i == count - 1) {
+                qz_vulkan_check(vkQueueSubmit(_handle, i - first + 1, &submit_infos[first], fence));
+                first = i + 1;
+            }
+        }
+    }
+
+    // Flushes unless another thread already does, that one rechecks the ring once it's done and picks up anything pushed meanwhile.
+    void Queue::_drain() noexcept {
+        while (_pending()) {
+            bool expected = false;
+            qz_unlikely_if(!_flushing.compare_exchange_strong(expected, true)) {
+                return;
+            }
+            _flush();
+            _flushing.store(false);
+        }
+    }
+
+    void Queue::_lock() noexcept {
+        while (_flushing.exchange(true)) {
+            std::this_thread::yield();
+        }
+    }
+
+    void Queue::_unlock() noexcept {
+        _flushing.store(false);
+        _drain();
+    }
+} // namespace qz::gfx
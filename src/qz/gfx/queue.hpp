@@ -7,19 +7,54 @@
 
 #include <cstdint>
 #include <memory>
-#include <mutex>
+#include <vector>
+#include <atomic>
 
 namespace qz::gfx {
+    // Submissions are written into a lock-free ring of slots, whichever thread gets to flush it issues
+    // everyone's submissions in ring order with as few vkQueueSubmit calls as their fences allow.
+    // The others return right away, leaving their work to the flushing thread.
     class Queue {
+        struct Submission {
+            VkCommandBuffer commands;
+            VkPipelineStageFlags stage;
+            VkSemaphore wait;
+            std::uint64_t wait_value;
+            VkSemaphore signal;
+            std::uint64_t signal_value;
+            VkFence fence;
+        };
+        // A slot's sequence is its position while free and its position plus one once written.
+        struct Slot {
+            std::atomic<std::uint64_t> sequence;
+            Submission submission;
+        };
         VkQueue _handle;
-        std::mutex _mutex;
+        std::unique_ptr<Slot[]> _slots;
+        std::atomic<std::uint64_t> _enqueue;
+        std::atomic<std::uint64_t> _dequeue;
+        std::atomic<bool> _flushing;
         std::uint32_t _family;
+        // Scratch space is only touched by the flushing thread.
+        std::vector<Submission> _submissions;
+        std::vector<VkTimelineSemaphoreSubmitInfo> _timeline_infos;
+        std::vector<VkSubmitInfo> _submit_infos;
+
+        void _push(const Submission&) noexcept;
+        qz_nodiscard bool _pending() const noexcept;
+        void _flush() noexcept;
+        void _drain() noexcept;
+        void _lock() noexcept;
+        void _unlock() noexcept;
     public:
         qz_nodiscard static std::unique_ptr<Queue> create(const Context&, std::uint32_t, std::uint32_t) noexcept;
 
+        // May return before vkQueueSubmit is issued, the thread flushing the queue at the time issues it instead.
+        // Submissions are still issued in the order they were made, present and wait_idle flush them first.
         void submit(const CommandBuffer&, VkPipelineStageFlags, VkSemaphore, VkSemaphore, VkFence) noexcept;
+        void submit(const CommandBuffer&, VkPipelineStageFlags, VkSemaphore, std::uint64_t, VkSemaphore, std::uint64_t, VkFence) noexcept;
         void present(const Swapchain&, std::uint32_t, VkSemaphore) noexcept;
-        void wait_idle() const noexcept;
+        void wait_idle() noexcept;
         qz_nodiscard std::uint32_t family() const noexcept;
     };
-} // namespace qz::gfx
\ No newline at end of file
+} // namespace qz::gfx
@@ -0,0 +1,92 @@
+#include <qz/gfx/recycling_pool.hpp>
+#include <qz/gfx/context.hpp>
+
+#include <algorithm>
+
+namespace qz::gfx {
+    // Command buffers handed out of a page before it's closed, and can only be reset along with the rest of it.
+    constexpr auto page_size = 16u;
+
+    qz_nodiscard std::unique_ptr<RecyclingPool> RecyclingPool::create(const Context&, std::uint32_t family) noexcept {
+        auto pool = std::make_unique<RecyclingPool>();
+        pool->_family = family;
+        pool->_current = 0;
+        return pool;
+    }
+
+    void RecyclingPool::destroy(const Context& context, RecyclingPool& pool) noexcept {
+        // Destroying the command pools frees their command buffers too.
+        for (const auto& page : pool._pages) {
+            vkDestroyCommandPool(context.device, page.handle, nullptr);
+        }
+        for (const auto fence : pool._fences) {
+            vkDestroyFence(context.device, fence, nullptr);
+        }
+        pool._pages.clear();
+        pool._fences.clear();
+    }
+
+    qz_nodiscard CommandBuffer RecyclingPool::acquire_command_buffer(const Context& context) noexcept {
+        auto& page = _open_page(context);
+        qz_unlikely_if(page.next == page.buffers.size()) {
+            page.buffers.emplace_back(CommandBuffer::allocate(context, page.handle).handle());
+        }
+        ++page.live;
+        return CommandBuffer::from_raw(page.handle, page.buffers[page.next++]);
+    }
+
+    qz_nodiscard VkFence RecyclingPool::acquire_fence(const Context& context) noexcept {
+        qz_likely_if(!_fences.empty()) {
+            const auto fence = _fences.back();
+            _fences.pop_back();
+            return fence;
+        }
+        VkFenceCreateInfo fence_create_info{};
+        fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        VkFence fence;
+        qz_vulkan_check(vkCreateFence(context.device, &fence_create_info, nullptr, &fence));
+        return fence;
+    }
+
+    // The command buffer must have completed, its page is reset as soon as it's both full and drained.
+    void RecyclingPool::recycle_command_buffer(const Context& context, CommandBuffer& command_buffer) noexcept {
+        const auto page = std::find_if(_pages.begin(), _pages.end(), [&command_buffer](const auto& each) {
+            return each.handle == command_buffer.pool();
+        });
+        qz_assert(page != _pages.end(), "command buffer was not acquired from this pool");
+        qz_unlikely_if(--page->live == 0 && page->next == page_size) {
+            qz_vulkan_check(vkResetCommandPool(context.device, page->handle, {}));
+            page->next = 0;
+        }
+        command_buffer = {};
+    }
+
+    void RecyclingPool::recycle_fence(const Context& context, VkFence fence) noexcept {
+        qz_vulkan_check(vkResetFences(context.device, 1, &fence));
+        _fences.emplace_back(fence);
+    }
+
+    // Pages other than the current one only have room left once they've been reset.
+    qz_nodiscard RecyclingPool::Page& RecyclingPool::_open_page(const Context& context) noexcept {
+        qz_likely_if(!_pages.empty() && _pages[_current].next < page_size) {
+            return _pages[_current];
+        }
+        for (std::uint32_t i = 0; i < _pages.size(); ++i) {
+            qz_likely_if(_pages[i].next < page_size) {
+                _current = i;
+                return _pages[i];
+            }
+        }
+
+        VkCommandPoolCreateInfo pool_create_info{};
+        pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        pool_create_info.queueFamilyIndex = _family;
+        auto& page = _pages.emplace_back();
+        qz_vulkan_check(vkCreateCommandPool(context.device, &pool_create_info, nullptr, &page.handle));
+        page.next = 0;
+        page.live = 0;
+        _current = _pages.size() - 1;
+        return page;
+    }
+} // namespace qz::gfx
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <qz/gfx/command_buffer.hpp>
+
+#include <qz/util/macros.hpp>
+#include <qz/util/fwd.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace qz::gfx {
+    // Command buffers and fences of one thread and queue family, recycled instead of destroyed.
+    // Command buffers are handed out of pages with a command pool each, a full page is reset as a whole once
+    // all of its command buffers came back. Only the owning thread may acquire from or recycle into the pool.
+    class RecyclingPool {
+        struct Page {
+            VkCommandPool handle;
+            std::vector<VkCommandBuffer> buffers;
+            std::uint32_t next;
+            std::uint32_t live;
+        };
+        std::vector<Page> _pages;
+        std::vector<VkFence> _fences;
+        std::uint32_t _family;
+        std::uint32_t _current;
+
+        qz_nodiscard Page& _open_page(const Context&) noexcept;
+    public:
+        qz_nodiscard static std::unique_ptr<RecyclingPool> create(const Context&, std::uint32_t) noexcept;
+        static void destroy(const Context&, RecyclingPool&) noexcept;
+
+        qz_nodiscard CommandBuffer acquire_command_buffer(const Context&) noexcept;
+        qz_nodiscard VkFence acquire_fence(const Context&) noexcept;
+        void recycle_command_buffer(const Context&, CommandBuffer&) noexcept;
+        void recycle_fence(const Context&, VkFence) noexcept;
+    };
+} // namespace qz::gfx
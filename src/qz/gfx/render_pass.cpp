@@ -1,8 +1,10 @@
 #include <qz/gfx/render_pass.hpp>
+#include <qz/gfx/swapchain.hpp>
 #include <qz/gfx/context.hpp>
 
+#include <algorithm>
 #include <optional>
-#include <map>
+#include <numeric>
 
 namespace qz::gfx {
     qz_nodiscard static VkImageLayout deduce_reference_layout(VkImageAspectFlags aspect) noexcept {
@@ -27,8 +29,9 @@ namespace qz::gfx {
         attachments.reserve(info.attachments.size());
         for (std::uint32_t index = 0; auto&& each : info.attachments) {
             Attachment attachment{
-                .image = each.image,
-                .owning = each.owning,
+                .image = each.swapchain ? (*each.swapchain)[0] : each.image,
+                .swapchain = each.swapchain,
+                .owning = each.owning && !each.swapchain,
                 .name = std::move(each.name),
                 .framebuffers = std::move(each.framebuffers),
                 .description = {
@@ -125,15 +128,33 @@ namespace qz::gfx {
         render_pass_create_info.pDependencies = dependencies.data();
         qz_vulkan_check(vkCreateRenderPass(context.device, &render_pass_create_info, nullptr, &render_pass._handle));
 
-        std::map<std::size_t, std::vector<VkImageView>> attachment_views;
+        // Swapchain backed passes get a framebuffer per swapchain image, picked with FrameInfo::image_idx.
+        std::size_t framebuffer_count = 0;
+        for (auto& each : render_pass._attachments) {
+            qz_unlikely_if(each.swapchain) {
+                each.framebuffers.resize(each.swapchain->images.size());
+                std::iota(each.framebuffers.begin(), each.framebuffers.end(), 0);
+            }
+            for (const auto framebuffer : each.framebuffers) {
+                framebuffer_count = std::max(framebuffer_count, framebuffer + 1);
+            }
+        }
+        for (auto& each : render_pass._attachments) {
+            qz_unlikely_if(each.framebuffers.empty()) {
+                each.framebuffers.resize(framebuffer_count);
+                std::iota(each.framebuffers.begin(), each.framebuffers.end(), 0);
+            }
+        }
+
+        std::vector<std::vector<VkImageView>> attachment_views(framebuffer_count);
         for (const auto& each : render_pass._attachments) {
             for (const auto framebuffer : each.framebuffers) {
-                attachment_views[framebuffer].emplace_back(each.image.view);
+                attachment_views[framebuffer].emplace_back(each.swapchain ? (*each.swapchain)[framebuffer].view : each.image.view);
             }
         }
 
-        render_pass._framebuffers.resize(attachment_views.size());
-        for (const auto& [index, views] : attachment_views) {
+        render_pass._framebuffers.resize(framebuffer_count);
+        for (std::size_t index = 0; const auto& views : attachment_views) {
             VkFramebufferCreateInfo framebuffer_create_info{};
             framebuffer_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
             framebuffer_create_info.flags = {};
@@ -143,7 +164,7 @@ namespace qz::gfx {
             framebuffer_create_info.width = framebuffer_size.width;
             framebuffer_create_info.height = framebuffer_size.height;
             framebuffer_create_info.layers = 1;
-            qz_vulkan_check(vkCreateFramebuffer(context.device, &framebuffer_create_info, nullptr, &render_pass._framebuffers[index]));
+            qz_vulkan_check(vkCreateFramebuffer(context.device, &framebuffer_create_info, nullptr, &render_pass._framebuffers[index++]));
         }
 
         return render_pass;
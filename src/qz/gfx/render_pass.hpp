@@ -15,7 +15,10 @@ namespace qz::gfx {
     struct Attachment {
         struct CreateInfo {
             Image image;
+            // Presentable attachments use the swapchain image selected by the framebuffer index.
+            const Swapchain* swapchain;
             std::string name;
+            // Attachments listing no framebuffers are shared by all of them.
             std::vector<std::size_t> framebuffers;
             bool owning;
             bool discard;
@@ -23,6 +26,7 @@ namespace qz::gfx {
             ClearValue clear;
         };
         Image image;
+        const Swapchain* swapchain;
         bool owning;
         std::string name;
         std::vector<std::size_t> framebuffers;
@@ -1,23 +1,43 @@
+#include <qz/gfx/texture_streamer.hpp>
+#include <qz/gfx/virtual_texture.hpp>
+#include <qz/gfx/deletion_queue.hpp>
 #include <qz/gfx/static_texture.hpp>
+#include <qz/gfx/task_manager.hpp>
 #include <qz/gfx/static_mesh.hpp>
 #include <qz/gfx/render_pass.hpp>
 #include <qz/gfx/swapchain.hpp>
 #include <qz/gfx/renderer.hpp>
+#include <qz/gfx/context.hpp>
 #include <qz/gfx/image.hpp>
 #include <qz/gfx/queue.hpp>
 
+#include <utility>
+
 namespace qz::gfx {
-    qz_nodiscard Renderer Renderer::create(const Context& context, const Window& window) noexcept {
+    qz_nodiscard static Renderer create_renderer(const Context& context, Swapchain&& swapchain) noexcept {
         Renderer renderer{};
-
-        // Create swapchain.
-        renderer.swapchain = Swapchain::create(context, window);
+        renderer.swapchain = std::move(swapchain);
+        renderer.in_flight = context.frames_in_flight;
 
         // Allocate rendering command buffers.
-        for (std::size_t i = 0; i < meta::in_flight; ++i) {
+        for (std::size_t i = 0; i < meta::max_in_flight; ++i) {
             renderer.gfx_cmds[i] = CommandBuffer::allocate(context, context.main_pool);
         }
 
+        // Create a transient pool per scheduler thread per frame, for recording draws in parallel.
+        VkCommandPoolCreateInfo pool_create_info{};
+        pool_create_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_create_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        pool_create_info.queueFamilyIndex = context.graphics->family();
+        const auto thread_count = context.task_manager->handle().GetThreadCount();
+        for (auto& pools : renderer.secondary_pools) {
+            pools.resize(thread_count);
+            for (auto& pool : pools) {
+                qz_vulkan_check(vkCreateCommandPool(context.device, &pool_create_info, nullptr, &pool.handle));
+                pool.used = 0;
+            }
+        }
+
         // Fence info.
         VkFenceCreateInfo fence_create_info{};
         fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
@@ -28,7 +48,7 @@ namespace qz::gfx {
         semaphore_create_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
         // Create all synchronization objects.
-        for (std::size_t i = 0; i < meta::in_flight; ++i) {
+        for (std::size_t i = 0; i < meta::max_in_flight; ++i) {
             qz_vulkan_check(vkCreateSemaphore(context.device, &semaphore_create_info, nullptr, &renderer.img_ready[i]));
             qz_vulkan_check(vkCreateSemaphore(context.device, &semaphore_create_info, nullptr, &renderer.gfx_done[i]));
             qz_vulkan_check(vkCreateFence(context.device, &fence_create_info, nullptr, &renderer.cmd_wait[i]));
@@ -39,14 +59,26 @@ namespace qz::gfx {
         return renderer;
     }
 
+    qz_nodiscard Renderer Renderer::create(const Context& context, const Window& window) noexcept {
+        return create_renderer(context, Swapchain::create(context, window));
+    }
+
+    // Renders into offscreen images, without a window, a surface or presentation.
+    qz_nodiscard Renderer Renderer::create(const Context& context, VkExtent2D extent) noexcept {
+        return create_renderer(context, Swapchain::create(context, extent));
+    }
+
     void Renderer::destroy(const Context& context, Renderer& renderer) noexcept {
         Swapchain::destroy(context, renderer.swapchain);
 
-        for (std::size_t i = 0; i < meta::in_flight; ++i) {
+        for (std::size_t i = 0; i < meta::max_in_flight; ++i) {
             CommandBuffer::destroy(context, renderer.gfx_cmds[i]);
             vkDestroySemaphore(context.device, renderer.img_ready[i], nullptr);
             vkDestroySemaphore(context.device, renderer.gfx_done[i], nullptr);
             vkDestroyFence(context.device, renderer.cmd_wait[i], nullptr);
+            for (const auto& pool : renderer.secondary_pools[i]) {
+                vkDestroyCommandPool(context.device, pool.handle, nullptr);
+            }
         }
 
         for (const auto& [_, layout] : renderer.layout_cache) {
@@ -56,19 +88,47 @@ namespace qz::gfx {
     }
 
     qz_nodiscard std::pair<CommandBuffer, FrameInfo> acquire_next_frame(Renderer& renderer, const Context& context) noexcept {
-        qz_vulkan_check(vkAcquireNextImageKHR(context.device, renderer.swapchain.handle, -1, renderer.img_ready[renderer.frame_idx], nullptr, &renderer.image_idx));
+        const auto headless = renderer.swapchain.headless;
+        qz_likely_if(!headless) {
+            qz_vulkan_check(vkAcquireNextImageKHR(context.device, renderer.swapchain.handle, -1, renderer.img_ready[renderer.frame_idx], nullptr, &renderer.image_idx));
+        } else {
+            // Offscreen images go with the frame slot, the fence waited on below guards both.
+            renderer.image_idx = renderer.frame_idx;
+        }
         qz_vulkan_check(vkWaitForFences(context.device, 1, &renderer.cmd_wait[renderer.frame_idx], true, -1));
 
+        // Work recorded for this frame index is done, resources it referenced can go and its feedback is readable.
+        for (auto& pool : renderer.secondary_pools[renderer.frame_idx]) {
+            qz_likely_if(pool.used) {
+                qz_vulkan_check(vkResetCommandPool(context.device, pool.handle, {}));
+                pool.used = 0;
+            }
+        }
+        context.deletion_queue->tick(context);
+        context.frame_allocator->begin(renderer.frame_idx);
+        context.streamer->update(context, renderer.frame_idx);
+        context.virtual_textures->update(context, renderer.frame_idx);
+
         return { renderer.gfx_cmds[renderer.frame_idx], {
             renderer.frame_idx,
             renderer.image_idx,
-            renderer.img_ready[renderer.frame_idx],
-            renderer.gfx_done[renderer.frame_idx],
+            headless ? nullptr : renderer.img_ready[renderer.frame_idx],
+            headless ? nullptr : renderer.gfx_done[renderer.frame_idx],
             renderer.cmd_wait[renderer.frame_idx],
             &renderer.swapchain[renderer.image_idx]
         } };
     }
 
+    // Only the calling thread's pool is touched, fibers sharing a thread never record at the same time.
+    qz_nodiscard CommandBuffer acquire_secondary(Renderer& renderer, const Context& context, const FrameInfo& frame) noexcept {
+        const auto thread_index = context.task_manager->handle().GetCurrentThreadIndex();
+        auto& pool = renderer.secondary_pools[frame.index][thread_index];
+        qz_unlikely_if(pool.used == pool.buffers.size()) {
+            pool.buffers.emplace_back(CommandBuffer::allocate(context, pool.handle, VK_COMMAND_BUFFER_LEVEL_SECONDARY));
+        }
+        return pool.buffers[pool.used++];
+    }
+
     void present_frame(Renderer& renderer,
                        const Context& context,
                        const CommandBuffer& command_buffer,
@@ -76,8 +136,17 @@ namespace qz::gfx {
                        VkPipelineStageFlags stage) noexcept {
         qz_vulkan_check(vkResetFences(context.device, 1, &frame.cmd_wait));
         context.graphics->submit(command_buffer, stage, frame.img_ready, frame.gfx_done, frame.cmd_wait);
-        context.graphics->present(renderer.swapchain, renderer.image_idx, frame.gfx_done);
+        qz_likely_if(!renderer.swapchain.headless) {
+            context.graphics->present(renderer.swapchain, renderer.image_idx, frame.gfx_done);
+        }
+
+        renderer.frame_idx = (renderer.frame_idx + 1) % renderer.in_flight;
+    }
 
-        renderer.frame_idx = (renderer.frame_idx + 1) % meta::in_flight;
+    // Drains every frame slot first, so the next frame starts over at slot zero with nothing in flight.
+    void set_frames_in_flight(Renderer& renderer, const Context& context, std::uint32_t count) noexcept {
+        qz_vulkan_check(vkWaitForFences(context.device, meta::max_in_flight, renderer.cmd_wait.data(), true, -1));
+        renderer.in_flight = clamp_frames_in_flight(count);
+        renderer.frame_idx = 0;
     }
 } // namespace qz::gfx
@@ -25,13 +25,22 @@ namespace qz::gfx {
         const Image* image;
     };
 
+    // Secondary buffers of one thread for one frame, the pool is reset once that frame's fence is signaled.
+    struct SecondaryPool {
+        VkCommandPool handle;
+        std::vector<CommandBuffer> buffers;
+        std::uint32_t used;
+    };
+
     struct Renderer {
         Swapchain swapchain;
 
         std::uint32_t image_idx;
         std::uint32_t frame_idx;
+        std::uint32_t in_flight;
 
         meta::in_flight_array_t<CommandBuffer> gfx_cmds;
+        meta::in_flight_array_t<std::vector<SecondaryPool>> secondary_pools;
         meta::in_flight_array_t<VkSemaphore> img_ready;
         meta::in_flight_array_t<VkSemaphore> gfx_done;
         meta::in_flight_array_t<VkFence> cmd_wait;
@@ -39,9 +48,12 @@ namespace qz::gfx {
         std::unordered_map<descriptor_layout_t, VkDescriptorSetLayout> layout_cache;
 
         qz_nodiscard static Renderer create(const Context&, const Window&) noexcept;
+        qz_nodiscard static Renderer create(const Context&, VkExtent2D) noexcept;
         static void destroy(const Context&, Renderer&) noexcept;
     };
 
     qz_nodiscard std::pair<CommandBuffer, FrameInfo> acquire_next_frame(Renderer&, const Context&) noexcept;
+    qz_nodiscard CommandBuffer acquire_secondary(Renderer&, const Context&, const FrameInfo&) noexcept;
     void present_frame(Renderer&, const Context&, const CommandBuffer&, const FrameInfo&, VkPipelineStageFlags) noexcept;
+    void set_frames_in_flight(Renderer&, const Context&, std::uint32_t) noexcept;
 } // namespace qz::gfx
\ No newline at end of file
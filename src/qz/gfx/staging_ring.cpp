@@ -0,0 +1,108 @@
+#include <qz/gfx/staging_ring.hpp>
+#include <qz/gfx/context.hpp>
+
+namespace qz::gfx {
+    // Blocks are tracked per granule, which is also the alignment every block starts at.
+    constexpr auto granule_size = 256ull;
+    constexpr auto released_bit = 1ull << 31;
+
+    // Block states carry the lap they were carved in, so a stale reclaim can't claim the same granule a lap later.
+    qz_nodiscard static std::uint64_t block_state(std::uint64_t position, std::uint64_t capacity, std::uint64_t size) noexcept {
+        return (position / capacity) << 32 | size / granule_size;
+    }
+
+    qz_nodiscard std::unique_ptr<StagingRing> StagingRing::create(const Context& context, const Settings& settings) noexcept {
+        auto ring = std::make_unique<StagingRing>();
+        const auto capacity = (settings.staging_size + granule_size - 1) & ~(granule_size - 1);
+        ring->_buffer = StaticBuffer::create(context, {
+            .flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .usage = VMA_MEMORY_USAGE_CPU_ONLY,
+            .capacity = capacity
+        });
+        ring->_blocks = std::make_unique<std::atomic<std::uint64_t>[]>(capacity / granule_size);
+        ring->_head = 0;
+        ring->_tail = 0;
+        return ring;
+    }
+
+    void StagingRing::destroy(const Context& context, StagingRing& ring) noexcept {
+        qz_assert(ring._head == ring._tail, "staging blocks still in use");
+        StaticBuffer::destroy(context, ring._buffer);
+        ring._blocks.reset();
+    }
+
+    qz_nodiscard StagingBlock StagingRing::allocate(const Context& context, std::size_t size) noexcept {
+        const auto capacity = _buffer.capacity;
+        const auto aligned = (size + granule_size - 1) & ~(granule_size - 1);
+        // Anything bigger than a quarter of the ring would starve every other upload.
+        qz_likely_if(aligned <= capacity / 4) {
+            auto head = _head.load(std::memory_order_relaxed);
+            while (true) {
+                // Blocks never straddle the end of the ring, the leftover space is skipped over.
+                auto start = head;
+                qz_unlikely_if(start % capacity + aligned > capacity) {
+                    start += capacity - start % capacity;
+                }
+                qz_unlikely_if(start + aligned - _tail.load(std::memory_order_acquire) > capacity) {
+                    break;
+                }
+                qz_likely_if(_head.compare_exchange_weak(head, start + aligned, std::memory_order_acq_rel)) {
+                    _blocks[start % capacity / granule_size].store(block_state(start, capacity, aligned), std::memory_order_release);
+                    qz_unlikely_if(start != head) {
+                        _blocks[head % capacity / granule_size].store(block_state(head, capacity, start - head) | released_bit, std::memory_order_release);
+                        _reclaim();
+                    }
+                    return {
+                        .buffer = _buffer,
+                        .offset = start % capacity,
+                        .size = size,
+                        .mapped = static_cast<char*>(_buffer.mapped) + start % capacity,
+                        .dedicated = false
+                    };
+                }
+            }
+        }
+
+        auto buffer = StaticBuffer::create(context, {
+            .flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            .usage = VMA_MEMORY_USAGE_CPU_ONLY,
+            .capacity = size
+        });
+        return {
+            .buffer = buffer,
+            .offset = 0,
+            .size = size,
+            .mapped = buffer.mapped,
+            .dedicated = true
+        };
+    }
+
+    void StagingRing::release(const Context& context, StagingBlock& block) noexcept {
+        qz_unlikely_if(block.dedicated) {
+            StaticBuffer::destroy(context, block.buffer);
+        } else {
+            _blocks[block.offset / granule_size].fetch_or(released_bit, std::memory_order_acq_rel);
+            _reclaim();
+        }
+        block = {};
+    }
+
+    // Moves the tail past every released block in front of it, whoever claims a block advances the tail.
+    void StagingRing::_reclaim() noexcept {
+        const auto capacity = _buffer.capacity;
+        while (true) {
+            const auto tail = _tail.load(std::memory_order_acquire);
+            qz_unlikely_if(tail == _head.load(std::memory_order_acquire)) {
+                return;
+            }
+            auto& block = _blocks[tail % capacity / granule_size];
+            auto state = block.load(std::memory_order_acquire);
+            qz_likely_if(!(state & released_bit) || (state >> 32) != (tail / capacity & 0xffffffff) ||
+                         !block.compare_exchange_strong(state, 0, std::memory_order_acq_rel)) {
+                return;
+            }
+            // Only the thread that cleared the block for this lap gets here, so the tail is still where it was loaded.
+            _tail.store(tail + (state & (released_bit - 1)) * granule_size, std::memory_order_release);
+        }
+    }
+} // namespace qz::gfx
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <qz/gfx/static_buffer.hpp>
+
+#include <qz/util/macros.hpp>
+#include <qz/util/fwd.hpp>
+
+#include <cstdint>
+#include <memory>
+#include <atomic>
+
+namespace qz::gfx {
+    struct StagingBlock {
+        StaticBuffer buffer;
+        std::size_t offset;
+        std::size_t size;
+        void* mapped;
+        bool dedicated;
+    };
+
+    // Persistently mapped staging memory shared by every upload. Blocks are carved out of the ring
+    // with a CAS on the head and given back in any order, the tail only moves past released blocks.
+    // Uploads too big for the ring, or that don't fit while it's full, get a dedicated buffer instead.
+    class StagingRing {
+        StaticBuffer _buffer;
+        std::unique_ptr<std::atomic<std::uint64_t>[]> _blocks;
+        std::atomic<std::uint64_t> _head;
+        std::atomic<std::uint64_t> _tail;
+
+        void _reclaim() noexcept;
+    public:
+        qz_nodiscard static std::unique_ptr<StagingRing> create(const Context&, const Settings&) noexcept;
+        static void destroy(const Context&, StagingRing&) noexcept;
+
+        qz_nodiscard StagingBlock allocate(const Context&, std::size_t) noexcept;
+        void release(const Context&, StagingBlock&) noexcept;
+    };
+} // namespace qz::gfx
@@ -14,7 +14,7 @@ namespace qz::gfx {
 
         VmaAllocationCreateInfo allocation_create_info{};
         allocation_create_info.flags = VMA_ALLOCATION_CREATE_MAPPED_BIT;
-        allocation_create_info.requiredFlags = {};
+        allocation_create_info.requiredFlags = info.required;
         allocation_create_info.preferredFlags = {};
         allocation_create_info.memoryTypeBits = {};
         allocation_create_info.pool = nullptr;
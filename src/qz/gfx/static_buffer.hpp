@@ -12,6 +12,7 @@ namespace qz::gfx {
             VkBufferUsageFlags flags;
             VmaMemoryUsage usage;
             std::size_t capacity;
+            VkMemoryPropertyFlags required;
         };
         VmaAllocation allocation;
         VkBufferUsageFlags flags;
@@ -1,6 +1,7 @@
 #include <qz/gfx/static_texture.hpp>
 #include <qz/gfx/static_model.hpp>
 #include <qz/gfx/static_mesh.hpp>
+#include <qz/gfx/io_pool.hpp>
 #include <qz/gfx/context.hpp>
 #include <qz/gfx/assets.hpp>
 
@@ -19,6 +20,9 @@
 
 #include <unordered_map>
 #include <filesystem>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
 #include <string>
 #include <vector>
 
@@ -32,6 +36,93 @@ namespace qz::gfx {
         std::string path;
     };
 
+    // A file the I/O threads read in full, Assimp parses out of memory and never waits on the disk.
+    class BufferedStream : public Assimp::IOStream {
+        std::vector<std::uint8_t> _bytes;
+        std::size_t _cursor;
+    public:
+        explicit BufferedStream(std::vector<std::uint8_t>&& bytes) noexcept
+            : _bytes(std::move(bytes)),
+              _cursor(0) {}
+
+        std::size_t Read(void* buffer, std::size_t size, std::size_t count) override {
+            qz_unlikely_if(size == 0) {
+                return 0;
+            }
+            count = std::min(count, (_bytes.size() - _cursor) / size);
+            std::memcpy(buffer, _bytes.data() + _cursor, size * count);
+            _cursor += size * count;
+            return count;
+        }
+
+        std::size_t Write(const void*, std::size_t, std::size_t) override {
+            return 0;
+        }
+
+        aiReturn Seek(std::size_t offset, aiOrigin origin) override {
+            const auto base = origin == aiOrigin_CUR ? _cursor : 0;
+            qz_unlikely_if(base + offset > _bytes.size()) {
+                return aiReturn_FAILURE;
+            }
+            _cursor = origin == aiOrigin_END ? _bytes.size() - offset : base + offset;
+            return aiReturn_SUCCESS;
+        }
+
+        std::size_t Tell() const override {
+            return _cursor;
+        }
+
+        std::size_t FileSize() const override {
+            return _bytes.size();
+        }
+
+        void Flush() override {}
+    };
+
+    // Every file Assimp opens, the model and whatever it references, is read on the I/O threads while the
+    // calling fiber is suspended. Parsing itself stays on the fiber.
+    class IoPoolSystem : public Assimp::IOSystem {
+        const Context& _context;
+        ftl::TaskScheduler* _scheduler;
+    public:
+        IoPoolSystem(const Context& context, ftl::TaskScheduler* scheduler) noexcept
+            : _context(context),
+              _scheduler(scheduler) {}
+
+        bool Exists(const char* path) const override {
+            return std::filesystem::exists(path);
+        }
+
+        char getOsSeparator() const override {
+            return '/';
+        }
+
+        Assimp::IOStream* Open(const char* path, const char* mode) override {
+            qz_unlikely_if(std::strchr(mode, 'w') || std::strchr(mode, 'a')) {
+                return nullptr;
+            }
+            std::vector<std::uint8_t> bytes;
+            bool opened = false;
+            _context.io->run(_context, _scheduler, [&bytes, &opened, path]() {
+                std::ifstream file(path, std::ios::binary | std::ios::ate);
+                qz_unlikely_if(!file) {
+                    return;
+                }
+                bytes.resize((std::size_t)file.tellg());
+                file.seekg(0);
+                opened = (bool)file.read(reinterpret_cast<char*>(bytes.data()), bytes.size());
+            });
+            qz_unlikely_if(!opened) {
+                return nullptr;
+            }
+            return new BufferedStream(std::move(bytes));
+        }
+
+        void Close(Assimp::IOStream* stream) override {
+            delete stream;
+        }
+    };
+
     qz_nodiscard static meta::Handle<StaticTexture> try_load_texture(const Context& context,
                                                                      const aiMaterial* material,
                                                                      aiTextureType type,
@@ -43,12 +134,18 @@ namespace qz::gfx {
         aiString str;
         material->GetTexture(type, 0, &str);
         const auto file_name = std::string(path) + "/" + str.C_Str();
-        const auto format = type == aiTextureType_DIFFUSE ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+        const auto kind = [type]() noexcept {
+            switch (type) {
+                case aiTextureType_HEIGHT:   return TextureKind::normal;
+                case aiTextureType_SPECULAR: return TextureKind::specular;
+                default:                     return TextureKind::diffuse;
+            }
+        }();
         const auto [cached, miss] = texture_cache.try_emplace(file_name);
         qz_likely_if(!miss) {
             return cached->second;
         }
-        return cached->second = StaticTexture::request(context, file_name, format);
+        return cached->second = StaticTexture::request(context, file_name, kind);
     }
 
     qz_nodiscard static TexturedMesh load_textured_mesh(const Context& context,
@@ -127,24 +224,26 @@ namespace qz::gfx {
         }
     }
 
-    static void do_model_load(ftl::TaskScheduler*, void* ptr) noexcept {
+    static void do_model_load(ftl::TaskScheduler* scheduler, TaskData<StaticModel>* task_data) noexcept {
         namespace fs = std::filesystem;
-        const auto* task_data = static_cast<const TaskData<StaticModel>*>(ptr);
         auto& [result, context, path] = *task_data;
         auto importer = new Assimp::Importer();
+        // The importer owns its I/O handler, it's never used past ReadFile.
+        importer->SetIOHandler(new IoPoolSystem(*context, scheduler));
         auto texture_cache = new TextureCache();
         const auto post_process =
             aiProcess_Triangulate |
             aiProcess_FlipUVs     |
             aiProcess_GenNormals  |
             aiProcess_CalcTangentSpace;
-        const auto scene = importer->ReadFile(path.data(), post_process);
+        (void)importer->ReadFile(path.data(), 0);
+        const auto scene = importer->ApplyPostProcessing(post_process);
         qz_assert(scene && !scene->mFlags && scene->mRootNode, "failed to load model");
         StaticModel model;
         process_node(*context, scene, scene->mRootNode, model, *texture_cache, fs::path(path).parent_path().generic_string());
         assets::finalize(result, std::move(model));
-        context->task_manager->insert({
-            .poll = [result = result]() -> VkResult {
+        context->task_manager->insert(
+            [result = result]() -> VkResult {
                 const auto model_lock = assets::acquire<StaticModel>();
                 const auto handle     = assets::from_handle(result);
                 qz_likely_if(std::all_of(handle.submeshes.begin(), handle.submeshes.end(), [](const auto& each) {
@@ -159,23 +258,18 @@ namespace qz::gfx {
                 }
                 return VK_NOT_READY;
             },
-            .cleanup = [task_data, importer, texture_cache]() {
-                delete task_data;
+            [importer, texture_cache]() {
                 delete importer;
                 delete texture_cache;
-            }
-        });
+            });
     }
 
     qz_nodiscard meta::Handle<StaticModel> StaticModel::request(const Context& context, std::string_view path) noexcept {
         const auto result = assets::emplace_empty<StaticModel>();
-        context.task_manager->add_task({
-            .Function = do_model_load,
-            .ArgData = new TaskData<StaticModel>{
-                result,
-                &context,
-                path.data()
-            }
+        context.task_manager->add_task<StaticModel>(do_model_load, {
+            result,
+            &context,
+            path.data()
         });
         return result;
     }
@@ -1,204 +1,220 @@
+#include <qz/gfx/texture_streamer.hpp>
+#include <qz/gfx/texture_atlas.hpp>
 #include <qz/gfx/static_texture.hpp>
-#include <qz/gfx/command_buffer.hpp>
+#include <qz/gfx/upload_batcher.hpp>
 #include <qz/gfx/static_buffer.hpp>
 #include <qz/gfx/task_manager.hpp>
 #include <qz/gfx/context.hpp>
+#include <qz/gfx/io_pool.hpp>
 #include <qz/gfx/assets.hpp>
-#include <qz/gfx/queue.hpp>
 
 #include <qz/util/file_view.hpp>
+#include <qz/util/pixels.hpp>
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
+#define STB_IMAGE_RESIZE_IMPLEMENTATION
+#include <stb_image_resize.h>
 
 #include <optional>
+#include <cstdint>
 #include <cstring>
+#include <memory>
+#include <vector>
 #include <thread>
 #include <cmath>
 
 namespace qz::gfx {
+    // Loads only the mip tail, finer levels are streamed in once the texture is actually sampled.
+    constexpr auto tail_level = ~0u;
+
+    struct TextureFormat {
+        VkFormat format;
+        std::uint32_t components;
+        VkComponentMapping swizzle;
+    };
+
     template <>
     struct TaskData<StaticTexture> {
-        VkFormat format;
+        TextureKind kind;
         std::string path;
         const Context* context;
         meta::Handle<StaticTexture> result;
+        std::uint32_t level;
+        bool packable;
     };
 
-    static void load_texture(ftl::TaskScheduler* scheduler, void* ptr) {
-        const auto* task_data = static_cast<const TaskData<StaticTexture>*>(ptr);
-        const auto thread_index = scheduler->GetCurrentThreadIndex();
+    qz_nodiscard static bool is_grayscale(const std::uint8_t* pixels, std::size_t texels, std::int32_t channels) noexcept {
+        qz_unlikely_if(channels < 3) {
+            return true;
+        }
+        for (std::size_t i = 0; i < texels; ++i, pixels += channels) {
+            qz_unlikely_if(pixels[0] != pixels[1] || pixels[0] != pixels[2]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Picks the smallest format that holds what the texture is used for, swizzled so that shaders still read RGBA.
+    qz_nodiscard static TextureFormat select_format(TextureKind kind, std::int32_t channels, bool grayscale) noexcept {
+        constexpr VkComponentMapping splat = {
+            VK_COMPONENT_SWIZZLE_R,
+            VK_COMPONENT_SWIZZLE_R,
+            VK_COMPONENT_SWIZZLE_R,
+            VK_COMPONENT_SWIZZLE_ONE
+        };
+        switch (kind) {
+            case TextureKind::diffuse:
+                return { VK_FORMAT_R8G8B8A8_SRGB, 4, {} };
+            case TextureKind::normal:
+                // Single channel bump textures are height maps, tangent space normals only keep X and Y.
+                // No shader samples normal maps yet, Z reads as one and whichever does has to rebuild it.
+                qz_unlikely_if(channels == 1) {
+                    return { VK_FORMAT_R8_UNORM, 1, splat };
+                }
+                return { VK_FORMAT_R8G8_UNORM, 2, {
+                    VK_COMPONENT_SWIZZLE_R,
+                    VK_COMPONENT_SWIZZLE_G,
+                    VK_COMPONENT_SWIZZLE_ONE,
+                    VK_COMPONENT_SWIZZLE_ONE
+                } };
+            case TextureKind::specular:
+                qz_likely_if(grayscale) {
+                    return { VK_FORMAT_R8_UNORM, 1, splat };
+                }
+                return { VK_FORMAT_R8G8B8A8_UNORM, 4, {} };
+        }
+        qz_unreachable();
+    }
+
+    static void resize_pixels(const std::uint8_t* source,
+                              std::int32_t width,
+                              std::int32_t height,
+                              std::uint8_t* dest,
+                              std::int32_t level_width,
+                              std::int32_t level_height,
+                              std::int32_t channels,
+                              bool srgb) noexcept {
+        qz_likely_if(srgb) {
+            const auto alpha = channels == 2 || channels == 4 ? channels - 1 : STBIR_ALPHA_CHANNEL_NONE;
+            stbir_resize_uint8_srgb(source, width, height, 0, dest, level_width, level_height, 0, channels, alpha, 0);
+        } else {
+            stbir_resize_uint8(source, width, height, 0, dest, level_width, level_height, 0, channels);
+        }
+    }
+
+    static void load_texture(ftl::TaskScheduler* scheduler, TaskData<StaticTexture>* task_data) {
         const auto& context = *task_data->context;
 
-        std::int32_t width, height, channels = 4;
-        auto file = util::FileView::create(task_data->path);
-        auto* image_data = stbi_load_from_memory(static_cast<const std::uint8_t*>(file.data()), file.size(), &width, &height, &channels, STBI_rgb_alpha);
-        util::FileView::destroy(file);
+        // Textures that are still streaming keep their decoded pixels around, only the first load decodes the file.
+        auto decoded = task_data->level != tail_level ? context.streamer->decoded(task_data->result) : DecodedTexture();
+        qz_unlikely_if(!decoded.pixels) {
+            // Reading is left to the I/O threads, only decoding happens on this worker.
+            util::FileView file;
+            context.io->run(context, scheduler, [&file, &path = task_data->path]() {
+                file = util::FileView::create(path, true);
+            });
+            decoded.pixels = std::shared_ptr<const std::uint8_t>(
+                stbi_load_from_memory(static_cast<const std::uint8_t*>(file.data()), file.size(), &decoded.width, &decoded.height, &decoded.channels, 0),
+                stbi_image_free);
+            util::FileView::destroy(file);
+        }
+        const auto width = decoded.width;
+        const auto height = decoded.height;
+        const auto channels = decoded.channels;
+        const auto* image_data = decoded.pixels.get();
+
+        const auto texels = (std::size_t)width * height;
+        const auto grayscale = task_data->kind == TextureKind::specular && is_grayscale(image_data, texels, channels);
+        const auto format = select_format(task_data->kind, channels, grayscale);
+
+        // Small diffuse textures share atlas pages instead of getting their own image and upload.
+        qz_unlikely_if(task_data->packable &&
+                       format.format == VK_FORMAT_R8G8B8A8_SRGB &&
+                       context.atlas->fits(width, height)) {
+            std::vector<std::uint8_t> pixels(texels * 4);
+            util::convert_pixels(image_data, channels, pixels.data(), 4, texels);
+            context.atlas->enqueue(task_data->result, pixels.data(), width, height);
+            return;
+        }
+        const auto mips = (std::uint32_t)std::floor(std::log2(std::max(width, height))) + 1;
+        const auto level = std::min(task_data->level == tail_level ? context.streamer->tail_level(mips) : task_data->level, mips - 1);
+        const auto level_width = std::max(width >> level, 1);
+        const auto level_height = std::max(height >> level, 1);
 
         auto image = Image::create(context, {
-            .width = (std::uint32_t)width,
-            .height = (std::uint32_t)height,
-            .mips = (std::uint32_t)std::floor(std::log2(std::max(width, height))) + 1,
-            .format = task_data->format,
+            .width = (std::uint32_t)level_width,
+            .height = (std::uint32_t)level_height,
+            .mips = mips - level,
+            .format = format.format,
             .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT |
                      VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
-                     VK_IMAGE_USAGE_SAMPLED_BIT
+                     VK_IMAGE_USAGE_SAMPLED_BIT,
+            .swizzle = format.swizzle
         });
-        auto staging = StaticBuffer::create(context, {
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VMA_MEMORY_USAGE_CPU_ONLY,
-            (std::size_t)width * height * 4
-        });
-        std::memcpy(staging.mapped, image_data, staging.capacity);
-        stbi_image_free(image_data);
-
-        auto transfer_cmd = CommandBuffer::allocate(context, context.transfer_pools[thread_index]);
-        transfer_cmd
-            .begin()
-                .insert_layout_transition({
-                    .image = &image,
-                    .mip = 0,
-                    .levels = 0,
-                    .source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
-                    .dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
-                    .source_access = {},
-                    .dest_access = VK_ACCESS_TRANSFER_WRITE_BIT,
-                    .old_layout = VK_IMAGE_LAYOUT_UNDEFINED,
-                    .new_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-                })
-                .copy_buffer_to_image(staging, image)
-                .transfer_ownership({
-                    .image = &image,
-                    .mip = 0,
-                    .levels = 0,
-                    .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
-                    .dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
-                    .source_access = VK_ACCESS_TRANSFER_WRITE_BIT,
-                    .dest_access = {},
-                    .old_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                    .new_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
-                }, *context.transfer, *context.graphics)
-            .end();
-
-        VkSemaphoreCreateInfo semaphore_info{};
-        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-        VkSemaphore transfer_done, graphics_done;
-        qz_vulkan_check(vkCreateSemaphore(context.device, &semaphore_info, nullptr, &transfer_done));
-        qz_vulkan_check(vkCreateSemaphore(context.device, &semaphore_info, nullptr, &graphics_done));
-        context.transfer->submit(transfer_cmd, {}, nullptr, transfer_done, nullptr);
-
-        auto ownership_cmd = CommandBuffer::allocate(context, context.transient_pools[thread_index]);
-        ownership_cmd
-            .begin()
-                .transfer_ownership({
-                    .image = &image,
-                    .mip = 0,
-                    .levels = 0,
-                    .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
-                    .dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
-                    .source_access = {},
-                    .dest_access = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
-                    .old_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                    .new_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
-                }, *context.transfer, *context.graphics)
-            .end();
-        context.graphics->submit(ownership_cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, transfer_done, graphics_done, nullptr);
-
-        VkFenceCreateInfo fence_create_info{};
-        fence_create_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-        VkFence request_done;
-        qz_vulkan_check(vkCreateFence(context.device, &fence_create_info, nullptr, &request_done));
-        auto mipmaps_cmd = CommandBuffer::allocate(context, context.transient_pools[thread_index]);
-        mipmaps_cmd.begin();
-        for (std::uint32_t mip = 1; mip < image.mips; ++mip) {
-            mipmaps_cmd
-                .insert_layout_transition({
-                    .image = &image,
-                    .mip = mip,
-                    .levels = 1,
-                    .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
-                    .dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
-                    .source_access = {},
-                    .dest_access = VK_ACCESS_TRANSFER_WRITE_BIT,
-                    .old_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                    .new_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-                })
-                .blit_image({
-                    .source_image = &image,
-                    .dest_image = nullptr,
-                    .source_off = {
-                        (std::int32_t)image.width >> (mip - 1),
-                        (std::int32_t)image.height >> (mip - 1),
-                        1
-                    },
-                    .dest_off = {
-                        (std::int32_t)image.width >> mip,
-                        (std::int32_t)image.height >> mip,
-                        1
-                    },
-                    .source_mip = mip - 1,
-                    .dest_mip = mip
-                });
-            if (mip != image.mips - 1) {
-                mipmaps_cmd.insert_layout_transition({
-                    .image = &image,
-                    .mip = mip,
-                    .levels = 1,
-                    .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
-                    .dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
-                    .source_access = VK_ACCESS_TRANSFER_WRITE_BIT,
-                    .dest_access = VK_ACCESS_TRANSFER_READ_BIT,
-                    .old_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                    .new_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
-                });
-            } else {
-                mipmaps_cmd.insert_layout_transition({
-                    .image = &image,
-                    .mip = mip,
-                    .levels = 1,
-                    .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
-                    .dest_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                    .source_access = VK_ACCESS_TRANSFER_WRITE_BIT,
-                    .dest_access = VK_ACCESS_SHADER_READ_BIT,
-                    .old_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                    .new_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-                });
-            }
+        auto staging = context.staging->allocate(context, (std::size_t)level_width * level_height * format.components);
+        // Decoded pixels are repacked straight into the staging buffer, coarser levels are resized beforehand.
+        const auto level_texels = (std::size_t)level_width * level_height;
+        std::vector<std::uint8_t> resized;
+        const auto* pixels = image_data;
+        qz_unlikely_if(level != 0) {
+            resized.resize(level_texels * channels);
+            resize_pixels(image_data, width, height, resized.data(), level_width, level_height, channels, format.format == VK_FORMAT_R8G8B8A8_SRGB);
+            pixels = resized.data();
         }
-        mipmaps_cmd
-                .insert_layout_transition({
-                    .image = &image,
-                    .mip = 0,
-                    .levels = std::max(image.mips - 1, 1u),
-                    .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
-                    .dest_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
-                    .source_access = VK_ACCESS_TRANSFER_READ_BIT,
-                    .dest_access = VK_ACCESS_SHADER_READ_BIT,
-                    .old_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                    .new_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
-                })
-            .end();
-        context.graphics->submit(mipmaps_cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, graphics_done, nullptr, request_done);
-        vkWaitForFences(context.device, 1, &request_done, true, -1);
-        vkDestroySemaphore(context.device, graphics_done, nullptr);
-        vkDestroySemaphore(context.device, transfer_done, nullptr);
-        vkDestroyFence(context.device, request_done, nullptr);
-        StaticBuffer::destroy(context, staging);
-        CommandBuffer::destroy(context, ownership_cmd);
-        CommandBuffer::destroy(context, transfer_cmd);
-        assets::finalize(task_data->result, StaticTexture::from_raw(image));
-        delete task_data;
+        util::convert_pixels(pixels, channels, static_cast<std::uint8_t*>(staging.mapped), format.components, level_texels);
+
+        // Recorded and submitted with every other upload of this tick, only this fiber waits for it.
+        const auto batch = context.uploads->enqueue({
+            .buffers = {},
+            .images = { { staging.buffer, staging.offset, image, level_texels * format.components } }
+        });
+        context.task_manager->wait(scheduler, [&context, batch]() {
+            return context.uploads->is_complete(context, batch) ? VK_SUCCESS : VK_NOT_READY;
+        });
+        context.staging->release(context, staging);
+        context.streamer->commit(context, task_data->result, image, {
+            .path = task_data->path,
+            .kind = task_data->kind,
+            .format = format.format,
+            .width = (std::uint32_t)width,
+            .height = (std::uint32_t)height,
+            .mips = mips,
+            .base = level
+        }, std::move(decoded));
     }
 
     qz_nodiscard StaticTexture StaticTexture::from_raw(const Image& handle) noexcept {
         StaticTexture texture{};
         texture._handle = handle;
+        texture._transform = { 1.0f, 1.0f, 0.0f, 0.0f };
+        texture._max_lod = VK_LOD_CLAMP_NONE;
+        texture._packed = false;
+        return texture;
+    }
+
+    qz_nodiscard StaticTexture StaticTexture::from_atlas(const Image& page, const glm::vec4& transform, float max_lod) noexcept {
+        StaticTexture texture{};
+        texture._handle = page;
+        texture._transform = transform;
+        texture._max_lod = max_lod;
+        texture._packed = true;
         return texture;
     }
 
-    qz_nodiscard meta::Handle<StaticTexture> StaticTexture::allocate(const Context& context, std::string_view path, VkFormat format) noexcept {
+    qz_nodiscard meta::Handle<StaticTexture> StaticTexture::allocate(const Context& context, std::string_view path, TextureKind kind) noexcept {
         using namespace std::literals;
-        const auto result = request(context, path, format);
+        // Blocking allocations never go through the atlas, its uploads are only flushed while polling transfers.
+        const auto result = assets::emplace_empty<StaticTexture>();
+        context.task_manager->add_task<StaticTexture>(load_texture, {
+            kind,
+            path.data(),
+            &context,
+            result,
+            tail_level,
+            false
+        });
         while (true) {
             {
                 const auto lock = assets::acquire<StaticTexture>();
@@ -212,26 +228,55 @@ namespace qz::gfx {
         return result;
     }
 
-    meta::Handle<StaticTexture> StaticTexture::request(const Context& context, std::string_view path, VkFormat format) noexcept {
+    meta::Handle<StaticTexture> StaticTexture::request(const Context& context, std::string_view path, TextureKind kind) noexcept {
         const auto result = assets::emplace_empty<StaticTexture>();
-        context.task_manager->add_task({
-            .Function = load_texture,
-            .ArgData = new TaskData<StaticTexture>{
-                format,
-                path.data(),
-                &context,
-                result,
-            }
+        context.task_manager->add_task<StaticTexture>(load_texture, {
+            kind,
+            path.data(),
+            &context,
+            result,
+            tail_level,
+            true
         });
         return result;
     }
 
+    void StaticTexture::stream(const Context& context,
+                               meta::Handle<StaticTexture> handle,
+                               std::string_view path,
+                               TextureKind kind,
+                               std::uint32_t level) noexcept {
+        context.task_manager->add_task<StaticTexture>(load_texture, {
+            kind,
+            path.data(),
+            &context,
+            handle,
+            level,
+            false
+        });
+    }
+
     void StaticTexture::destroy(const Context& context, StaticTexture& texture) noexcept {
-        Image::destroy(context, texture._handle);
+        // Packed textures only reference their atlas page.
+        qz_likely_if(!texture._packed) {
+            Image::destroy(context, texture._handle);
+        }
         texture = {};
     }
 
+    qz_nodiscard const Image& StaticTexture::image() const noexcept {
+        return _handle;
+    }
+
     qz_nodiscard VkImageView StaticTexture::view() const noexcept {
         return _handle.view;
     }
+
+    qz_nodiscard glm::vec4 StaticTexture::uv_transform() const noexcept {
+        return _transform;
+    }
+
+    qz_nodiscard float StaticTexture::max_lod() const noexcept {
+        return _max_lod;
+    }
 } // namespace qz::gfx
\ No newline at end of file
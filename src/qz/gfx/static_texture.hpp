@@ -5,17 +5,34 @@
 #include <qz/util/macros.hpp>
 #include <qz/util/fwd.hpp>
 
+#include <glm/vec4.hpp>
+
 #include <string_view>
+#include <cstdint>
 
 namespace qz::gfx {
+    enum class TextureKind {
+        diffuse,
+        normal,
+        specular
+    };
+
     class StaticTexture {
         Image _handle;
+        glm::vec4 _transform;
+        float _max_lod;
+        bool _packed;
     public:
         qz_nodiscard static StaticTexture from_raw(const Image&) noexcept;
-        qz_nodiscard static meta::Handle<StaticTexture> allocate(const Context&, std::string_view, VkFormat = VK_FORMAT_R8G8B8A8_SRGB) noexcept;
-        qz_nodiscard static meta::Handle<StaticTexture> request(const Context&, std::string_view, VkFormat = VK_FORMAT_R8G8B8A8_SRGB) noexcept;
+        qz_nodiscard static StaticTexture from_atlas(const Image&, const glm::vec4&, float) noexcept;
+        qz_nodiscard static meta::Handle<StaticTexture> allocate(const Context&, std::string_view, TextureKind = TextureKind::diffuse) noexcept;
+        qz_nodiscard static meta::Handle<StaticTexture> request(const Context&, std::string_view, TextureKind = TextureKind::diffuse) noexcept;
+        static void stream(const Context&, meta::Handle<StaticTexture>, std::string_view, TextureKind, std::uint32_t) noexcept;
         static void destroy(const Context&, StaticTexture&) noexcept;
 
+        qz_nodiscard const Image& image() const noexcept;
         qz_nodiscard VkImageView view() const noexcept;
+        qz_nodiscard glm::vec4 uv_transform() const noexcept;
+        qz_nodiscard float max_lod() const noexcept;
     };
 } // namespace qz::gfx
\ No newline at end of file
@@ -56,6 +56,8 @@ namespace qz::gfx {
             }
         }
         swapchain.format = format.format;
+        swapchain.layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        swapchain.headless = false;
 
         // Fill out VkSwapchainCreateInfoKHR struct, provide all the informations we gathered so far to create the swapchain and its images.
         VkSwapchainCreateInfoKHR swapchain_create_info{};
@@ -125,11 +127,41 @@ namespace qz::gfx {
         return swapchain;
     }
 
+    // Offscreen images owned by the swapchain, one per frame slot, recycled along with the frame's fence.
+    qz_nodiscard Swapchain Swapchain::create(const Context& context, VkExtent2D extent) noexcept {
+        Swapchain swapchain{};
+        swapchain.extent = extent;
+        swapchain.format = VK_FORMAT_B8G8R8A8_SRGB;
+        swapchain.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        swapchain.headless = true;
+        swapchain.images.reserve(meta::max_in_flight);
+        for (std::size_t i = 0; i < meta::max_in_flight; ++i) {
+            swapchain.images.emplace_back(Image::create(context, {
+                .width = extent.width,
+                .height = extent.height,
+                .mips = 1,
+                .format = swapchain.format,
+                .usage =
+                    VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                    VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                    VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+            }));
+        }
+        return swapchain;
+    }
+
     qz_nodiscard const Image& Swapchain::operator [](std::size_t idx) const noexcept {
         return images[idx];
     }
 
     void Swapchain::destroy(const Context& context, Swapchain& swapchain) noexcept {
+        qz_unlikely_if(swapchain.headless) {
+            for (auto& image : swapchain.images) {
+                Image::destroy(context, image);
+            }
+            swapchain = {};
+            return;
+        }
         for (const auto& image : swapchain.images) {
             vkDestroyImageView(context.device, image.view, nullptr);
         }
@@ -15,9 +15,13 @@ namespace qz::gfx {
         VkSwapchainKHR handle;
         VkExtent2D extent;
         VkFormat format;
+        // Layout frames are left in, for presentation or for reading back offscreen images.
+        VkImageLayout layout;
         std::vector<Image> images;
+        bool headless;
 
         qz_nodiscard static Swapchain create(const Context&, const Window&) noexcept;
+        qz_nodiscard static Swapchain create(const Context&, VkExtent2D) noexcept;
         static void destroy(const Context&, Swapchain&) noexcept;
 
         qz_nodiscard const Image& operator [](std::size_t) const noexcept;
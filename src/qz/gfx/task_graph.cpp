@@ -0,0 +1,133 @@
+#include <qz/gfx/task_manager.hpp>
+#include <qz/gfx/task_graph.hpp>
+#include <qz/gfx/context.hpp>
+
+#include <unordered_map>
+#include <algorithm>
+#include <utility>
+
+namespace qz::gfx {
+    qz_nodiscard static bool intersects(const std::vector<std::string>& lhs, const std::vector<std::string>& rhs) noexcept {
+        return std::any_of(lhs.begin(), lhs.end(), [&rhs](const auto& each) {
+            return std::find(rhs.begin(), rhs.end(), each) != rhs.end();
+        });
+    }
+
+    qz_nodiscard TaskGraph TaskGraph::create(const Context& context, std::vector<TaskNode>&& nodes) noexcept {
+        TaskGraph graph{};
+        graph._nodes = std::move(nodes);
+        graph._scheduler = &context.task_manager->handle();
+        graph._counter = std::make_unique<ftl::TaskCounter>(graph._scheduler);
+        graph._launched = std::make_unique<ftl::TaskCounter>(graph._scheduler);
+
+        const auto count = graph._nodes.size();
+        std::unordered_map<std::string, std::size_t> indices;
+        for (std::size_t i = 0; i < count; ++i) {
+            qz_assert(indices.emplace(graph._nodes[i].name, i).second, "duplicate task node name");
+        }
+
+        // Hazards follow declaration order, explicit dependencies may point anywhere.
+        std::vector<std::vector<std::size_t>> successors(count);
+        std::vector<std::uint32_t> predecessors(count);
+        const auto add_edge = [&](std::size_t from, std::size_t to) {
+            qz_likely_if(std::find(successors[from].begin(), successors[from].end(), to) == successors[from].end()) {
+                successors[from].emplace_back(to);
+                ++predecessors[to];
+            }
+        };
+        for (std::size_t j = 0; j < count; ++j) {
+            const auto& node = graph._nodes[j];
+            for (const auto& name : node.after) {
+                const auto dependency = indices.find(name);
+                qz_assert(dependency != indices.end(), "unknown task node dependency");
+                add_edge(dependency->second, j);
+            }
+            for (std::size_t i = 0; i < j; ++i) {
+                const auto& other = graph._nodes[i];
+                qz_unlikely_if(intersects(other.writes, node.reads) ||
+                               intersects(other.writes, node.writes) ||
+                               intersects(other.reads, node.writes)) {
+                    add_edge(i, j);
+                }
+            }
+        }
+
+        // Kahn's algorithm one level at a time, every level is a wave.
+        std::vector<std::size_t> ready;
+        for (std::size_t i = 0; i < count; ++i) {
+            qz_unlikely_if(!predecessors[i]) {
+                ready.emplace_back(i);
+            }
+        }
+        std::size_t visited = 0;
+        while (!ready.empty()) {
+            auto& wave = graph._waves.emplace_back();
+            std::vector<std::size_t> next;
+            for (const auto index : ready) {
+                auto& node = graph._nodes[index];
+                qz_unlikely_if(node.pinned) {
+                    wave.pinned.emplace_back(index);
+                } else {
+                    wave.tasks.push_back({
+                        .Function = +[](ftl::TaskScheduler*, void* ptr) {
+                            static_cast<TaskNode*>(ptr)->function();
+                        },
+                        .ArgData = &node
+                    });
+                }
+                for (const auto successor : successors[index]) {
+                    qz_unlikely_if(!--predecessors[successor]) {
+                        next.emplace_back(successor);
+                    }
+                }
+            }
+            visited += ready.size();
+            ready = std::move(next);
+        }
+        qz_assert(visited == count, "task graph has a cycle");
+        return graph;
+    }
+
+    void TaskGraph::run(const Context&) noexcept {
+        _run();
+    }
+
+    void TaskGraph::launch(const Context&) noexcept {
+        _scheduler->AddTask({
+            .Function = +[](ftl::TaskScheduler*, void* ptr) {
+                static_cast<TaskGraph*>(ptr)->_run();
+            },
+            .ArgData = this
+        }, ftl::TaskPriority::High, _launched.get());
+    }
+
+    void TaskGraph::wait(const Context&) noexcept {
+        _scheduler->WaitForCounter(_launched.get(), 0, true);
+    }
+
+    qz_nodiscard std::size_t TaskGraph::waves() const noexcept {
+        return _waves.size();
+    }
+
+    // The calling fiber takes the last task of a wave itself, unless it has pinned nodes to run instead.
+    void TaskGraph::_run() noexcept {
+        auto& scheduler = *_scheduler;
+        for (auto& [tasks, pinned] : _waves) {
+            const auto inline_last = pinned.empty() && !tasks.empty();
+            const auto dispatched = (std::uint32_t)tasks.size() - inline_last;
+            qz_likely_if(dispatched) {
+                scheduler.AddTasks(dispatched, tasks.data(), ftl::TaskPriority::High, _counter.get());
+            }
+            for (const auto index : pinned) {
+                _nodes[index].function();
+            }
+            qz_likely_if(inline_last) {
+                tasks.back().Function(&scheduler, tasks.back().ArgData);
+            }
+            qz_likely_if(dispatched) {
+                // Pinned, the main thread must come back to the main thread.
+                scheduler.WaitForCounter(_counter.get(), 0, true);
+            }
+        }
+    }
+} // namespace qz::gfx
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <qz/util/macros.hpp>
+#include <qz/util/fwd.hpp>
+
+#include <ftl/task_scheduler.h>
+#include <ftl/task_counter.h>
+
+#include <functional>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace qz::gfx {
+    // Resources are plain names, a node depends on every earlier node it has a hazard with on any of them.
+    // Pinned nodes run on the thread calling run, for work such as reading window input.
+    struct TaskNode {
+        std::string name;
+        std::vector<std::string> after;
+        std::vector<std::string> reads;
+        std::vector<std::string> writes;
+        std::function<void()> function;
+        bool pinned;
+    };
+
+    // Compiled once into waves of nodes without dependencies among each other, each frame a wave is
+    // spread across ftl workers and the calling fiber waits on a counter before moving to the next one.
+    class TaskGraph {
+        struct Wave {
+            std::vector<ftl::Task> tasks;
+            std::vector<std::size_t> pinned;
+        };
+        std::vector<TaskNode> _nodes;
+        std::vector<Wave> _waves;
+        std::unique_ptr<ftl::TaskCounter> _counter;
+        std::unique_ptr<ftl::TaskCounter> _launched;
+        ftl::TaskScheduler* _scheduler;
+
+        void _run() noexcept;
+    public:
+        qz_nodiscard static TaskGraph create(const Context&, std::vector<TaskNode>&&) noexcept;
+
+        void run(const Context&) noexcept;
+        // Runs the graph from a worker while the caller goes on, pinned nodes then run on that worker.
+        void launch(const Context&) noexcept;
+        void wait(const Context&) noexcept;
+        qz_nodiscard std::size_t waves() const noexcept;
+    };
+} // namespace qz::gfx
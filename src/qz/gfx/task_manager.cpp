@@ -1,33 +1,151 @@
 #include <qz/gfx/task_manager.hpp>
+#include <qz/gfx/context.hpp>
+
+#include <qz/util/affinity.hpp>
+
+#include <algorithm>
+#include <utility>
+#include <memory>
+#include <vector>
 
 namespace qz::gfx {
-    qz_nodiscard TaskManager::TaskManager() noexcept {
+    // Stubs polled per tick at most, the main thread's cost stays flat no matter how many loads are pending.
+    constexpr auto max_polls_per_tick = 64u;
+    constexpr auto records_per_chunk = 64u;
+
+    // The calling thread becomes a worker too, it's restricted to the same cores.
+    qz_nodiscard TaskManager::TaskManager(const Settings& settings) noexcept {
+        _incoming = nullptr;
+        _cursor = 0;
+        _affinity = settings.worker_affinity;
+        util::set_thread_affinity(_affinity);
         _handle.Init({
-            .Behavior = ftl::EmptyQueueBehavior::Sleep
+            .ThreadPoolSize = settings.worker_threads,
+            .Behavior = ftl::EmptyQueueBehavior::Sleep,
+            .Callbacks = {
+                .Context = &_affinity,
+                .OnWorkerThreadStarted = +[](void* context, unsigned) {
+                    util::set_thread_affinity(*static_cast<const std::uint64_t*>(context));
+                }
+            }
         });
+        _caches = std::make_unique<RecordCache[]>(_handle.GetThreadCount());
     }
 
     qz_nodiscard ftl::TaskScheduler& TaskManager::handle() noexcept {
         return _handle;
     }
 
-    void TaskManager::add_task(ftl::Task&& task) noexcept {
-        std::lock_guard<std::mutex> lock(_mutex);
-        _handle.AddTask(task, ftl::TaskPriority::High);
+    // The calling fiber runs the first index itself, then waits pinned so that the main thread stays the main thread.
+    void TaskManager::parallel_for(std::uint32_t count, const std::function<void(std::uint32_t)>& function) noexcept {
+        struct Chunk {
+            const std::function<void(std::uint32_t)>* function;
+            std::uint32_t index;
+        };
+        qz_unlikely_if(count == 0) {
+            return;
+        }
+        std::vector<Chunk> chunks(count);
+        std::vector<ftl::Task> tasks(count - 1);
+        for (std::uint32_t i = 0; i < count; ++i) {
+            chunks[i] = { &function, i };
+            qz_likely_if(i) {
+                tasks[i - 1] = {
+                    .Function = +[](ftl::TaskScheduler*, void* ptr) {
+                        const auto* chunk = static_cast<const Chunk*>(ptr);
+                        (*chunk->function)(chunk->index);
+                    },
+                    .ArgData = &chunks[i]
+                };
+            }
+        }
+        ftl::TaskCounter counter(&_handle);
+        qz_likely_if(!tasks.empty()) {
+            _handle.AddTasks(tasks.size(), tasks.data(), ftl::TaskPriority::High, &counter);
+        }
+        function(0);
+        qz_likely_if(!tasks.empty()) {
+            _handle.WaitForCounter(&counter, 0, true);
+        }
     }
 
-    void TaskManager::insert(TaskStub&& stub) noexcept {
-        std::lock_guard<std::mutex> lock(_mutex);
-        _tasks.emplace_back(stub);
+    void TaskManager::tick() noexcept {
+        for (auto* record = _incoming.exchange(nullptr); record;) {
+            auto* next = record->next;
+            _pending.emplace_back(record);
+            record = next;
+        }
+
+        // Completed stubs are swapped with the last one, which is polled next. A tick polls each stub about once at most.
+        const auto polls = std::min<std::size_t>(max_polls_per_tick, _pending.size());
+        for (std::size_t i = 0; i < polls; ++i) {
+            qz_unlikely_if(_cursor >= _pending.size()) {
+                _cursor = 0;
+            }
+            auto* record = _pending[_cursor];
+            qz_unlikely_if(record->poll(record->payload) == VK_SUCCESS) {
+                record->complete(record->payload);
+                _release(record);
+                _pending[_cursor] = _pending.back();
+                _pending.pop_back();
+            } else {
+                ++_cursor;
+            }
+        }
     }
 
-    void TaskManager::tick() noexcept {
-        std::lock_guard<std::mutex> lock(_mutex);
-        for (std::size_t i = 0; i < _tasks.size(); ++i) {
-            qz_unlikely_if(_tasks[i].poll() == VK_SUCCESS) {
-                _tasks[i].cleanup();
-                _tasks.erase(_tasks.begin() + i++);
+    // Records come from the calling thread's cache, only an empty cache goes to the shared pool for a whole batch.
+    qz_nodiscard TaskRecord* TaskManager::_acquire() noexcept {
+        auto& cache = _caches[_handle.GetCurrentThreadIndex()];
+        qz_unlikely_if(!cache.records) {
+            std::lock_guard<std::mutex> lock(_pool_mutex);
+            qz_likely_if(!_batches.empty()) {
+                cache.records = _batches.back();
+                _batches.pop_back();
+            } else {
+                auto chunk = std::make_unique<TaskRecord[]>(records_per_chunk);
+                for (std::uint32_t i = 0; i < records_per_chunk - 1; ++i) {
+                    chunk[i].next = &chunk[i + 1];
+                }
+                chunk[records_per_chunk - 1].next = nullptr;
+                cache.records = chunk.get();
+                _chunks.emplace_back(std::move(chunk));
             }
+            cache.count = records_per_chunk;
         }
+        auto* record = cache.records;
+        cache.records = record->next;
+        --cache.count;
+        record->owner = this;
+        record->next = nullptr;
+        record->references = 1;
+        return record;
+    }
+
+    void TaskManager::_release(TaskRecord* record) noexcept {
+        qz_unlikely_if(record->references.fetch_sub(1) != 1) {
+            return;
+        }
+        record->destroy(record);
+        // Stubs are mostly released on the main thread, its cache gives every batch it fills back to the pool.
+        auto& cache = _caches[_handle.GetCurrentThreadIndex()];
+        record->next = cache.records;
+        cache.records = record;
+        qz_unlikely_if(++cache.count == 2 * records_per_chunk) {
+            auto* last = record;
+            for (std::uint32_t i = 1; i < records_per_chunk; ++i) {
+                last = last->next;
+            }
+            cache.records = last->next;
+            cache.count -= records_per_chunk;
+            last->next = nullptr;
+            std::lock_guard<std::mutex> lock(_pool_mutex);
+            _batches.emplace_back(record);
+        }
+    }
+
+    void TaskManager::_enqueue(TaskRecord* record) noexcept {
+        record->next = _incoming.load();
+        while (!_incoming.compare_exchange_weak(record->next, record));
     }
-} // namespace qz::gfx
\ No newline at end of file
+} // namespace qz::gfx
@@ -6,27 +6,142 @@
 #include <vulkan/vulkan.h>
 
 #include <ftl/task_scheduler.h>
+#include <ftl/task_counter.h>
 
+#include <type_traits>
 #include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <atomic>
+#include <memory>
 #include <vector>
 #include <mutex>
+#include <new>
 
 namespace qz::gfx {
-    struct TaskStub {
-        std::function<VkResult()> poll;
-        std::function<void()> cleanup;
+    // Pooled, type-erased storage for a task's data or a stub's poll and cleanup. Payloads small enough live
+    // inline, larger ones spill to the heap. The same link is used by the record caches and the completion queue.
+    struct TaskRecord {
+        alignas(std::max_align_t) std::byte storage[192];
+        void* payload;
+        VkResult (*poll)(void*);
+        void (*complete)(void*);
+        void (*destroy)(TaskRecord*);
+        TaskManager* owner;
+        TaskRecord* next;
+        std::atomic<std::uint32_t> references;
     };
 
+    // Loaders push stubs onto a lock-free list from any thread, the main thread's tick moves them to a list
+    // only it touches and polls a bounded number of them per call, round robin.
     class TaskManager {
-        std::vector<TaskStub> _tasks;
+        // Free records, one cache per worker thread. Caches trade whole batches with the shared pool.
+        struct alignas(64) RecordCache {
+            TaskRecord* records;
+            std::uint32_t count;
+        };
+        std::vector<std::unique_ptr<TaskRecord[]>> _chunks;
+        std::vector<TaskRecord*> _batches;
+        std::unique_ptr<RecordCache[]> _caches;
+        std::vector<TaskRecord*> _pending;
+        std::atomic<TaskRecord*> _incoming;
+        std::size_t _cursor;
+        std::uint64_t _affinity;
         ftl::TaskScheduler _handle;
-        std::mutex _mutex;
+        std::mutex _pool_mutex;
+
+        qz_nodiscard TaskRecord* _acquire() noexcept;
+        void _release(TaskRecord*) noexcept;
+        void _enqueue(TaskRecord*) noexcept;
+
+        template <typename T, typename... Args>
+        static void _emplace(TaskRecord* record, Args&&... args) noexcept {
+            constexpr auto fits = sizeof(T) <= sizeof(TaskRecord::storage) && alignof(T) <= alignof(std::max_align_t);
+            if constexpr (fits) {
+                record->payload = new (record->storage) T{ std::forward<Args>(args)... };
+            } else {
+                record->payload = new T{ std::forward<Args>(args)... };
+            }
+            record->destroy = +[](TaskRecord* record) {
+                auto* payload = static_cast<T*>(record->payload);
+                if constexpr (fits) {
+                    payload->~T();
+                } else {
+                    delete payload;
+                }
+            };
+        }
     public:
-        qz_nodiscard TaskManager() noexcept;
+        qz_nodiscard TaskManager(const Settings&) noexcept;
 
         qz_nodiscard ftl::TaskScheduler& handle() noexcept;
-        void add_task(ftl::Task&&) noexcept;
-        void insert(TaskStub&&) noexcept;
+
+        // The task data lives in a pooled record until the function returns.
+        template <typename T>
+        void add_task(void (*function)(ftl::TaskScheduler*, TaskData<T>*), TaskData<T>&& data) noexcept {
+            struct Task {
+                void (*function)(ftl::TaskScheduler*, TaskData<T>*);
+                TaskData<T> data;
+            };
+            auto* record = _acquire();
+            _emplace<Task>(record, function, std::move(data));
+            _handle.AddTask({
+                .Function = +[](ftl::TaskScheduler* scheduler, void* ptr) {
+                    auto* record = static_cast<TaskRecord*>(ptr);
+                    auto* task = static_cast<Task*>(record->payload);
+                    task->function(scheduler, &task->data);
+                    record->owner->_release(record);
+                },
+                .ArgData = record
+            }, ftl::TaskPriority::High);
+        }
+
+        template <typename P, typename C>
+        void insert(P&& poll, C&& cleanup) noexcept {
+            struct Stub {
+                std::decay_t<P> poll;
+                std::decay_t<C> cleanup;
+            };
+            auto* record = _acquire();
+            _emplace<Stub>(record, std::forward<P>(poll), std::forward<C>(cleanup));
+            record->poll = +[](void* payload) -> VkResult {
+                return static_cast<Stub*>(payload)->poll();
+            };
+            record->complete = +[](void* payload) {
+                static_cast<Stub*>(payload)->cleanup();
+            };
+            _enqueue(record);
+        }
+
+        // Suspends the calling fiber instead of its worker thread, the poll runs on the main thread along with every other stub.
+        // The fiber may resume while the main thread is still inside Decrement, the record goes back once both let go of it.
+        template <typename P>
+        void wait(ftl::TaskScheduler* scheduler, P&& poll) noexcept {
+            struct Stub {
+                std::decay_t<P> poll;
+                ftl::TaskCounter counter;
+
+                Stub(std::decay_t<P> poll, ftl::TaskScheduler* scheduler) noexcept
+                    : poll(std::move(poll)),
+                      counter(scheduler, 1) {}
+            };
+            auto* record = _acquire();
+            _emplace<Stub>(record, std::forward<P>(poll), scheduler);
+            record->references = 2;
+            record->poll = +[](void* payload) -> VkResult {
+                return static_cast<Stub*>(payload)->poll();
+            };
+            record->complete = +[](void* payload) {
+                static_cast<Stub*>(payload)->counter.Decrement();
+            };
+            auto* counter = &static_cast<Stub*>(record->payload)->counter;
+            _enqueue(record);
+            scheduler->WaitForCounter(counter, 0);
+            _release(record);
+        }
+
+        void parallel_for(std::uint32_t, const std::function<void(std::uint32_t)>&) noexcept;
         void tick() noexcept;
     };
-} // namespace qz::gfx
\ No newline at end of file
+} // namespace qz::gfx
@@ -0,0 +1,239 @@
+#include <qz/gfx/command_buffer.hpp>
+#include <qz/gfx/texture_atlas.hpp>
+#include <qz/gfx/staging_ring.hpp>
+#include <qz/gfx/task_manager.hpp>
+#include <qz/gfx/context.hpp>
+#include <qz/gfx/assets.hpp>
+#include <qz/gfx/queue.hpp>
+
+#include <stb_image_resize.h>
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+#include <bit>
+
+namespace qz::gfx {
+    // Padding keeps filtering from reading neighbours.
+    constexpr auto atlas_padding = 4u;
+
+    // Entries keep their mips down to about two texels, so that minified textures don't alias.
+    qz_nodiscard static std::uint32_t entry_mips(std::uint32_t width, std::uint32_t height) noexcept {
+        return std::max<std::uint32_t>(std::bit_width(std::min(width, height)), 2u) - 1;
+    }
+
+    // Rectangles are aligned to the entry's coarsest mip, so that every level starts on a whole texel.
+    qz_nodiscard static std::uint32_t rect_size(std::uint32_t size, std::uint32_t mips) noexcept {
+        const auto alignment = 1u << (mips - 1);
+        return (size + 2 * atlas_padding + alignment - 1) & ~(alignment - 1);
+    }
+
+    qz_nodiscard static std::size_t rect_bytes(std::uint32_t width, std::uint32_t height, std::uint32_t mips) noexcept {
+        std::size_t bytes = 0;
+        for (std::uint32_t mip = 0; mip < mips; ++mip) {
+            bytes += (std::size_t)(width >> mip) * (height >> mip) * 4;
+        }
+        return bytes;
+    }
+
+    qz_nodiscard std::unique_ptr<TextureAtlas> TextureAtlas::create(const Context&, const Settings& settings) noexcept {
+        auto atlas = std::make_unique<TextureAtlas>();
+        atlas->_threshold = settings.atlas_threshold;
+        atlas->_size = settings.atlas_size;
+        return atlas;
+    }
+
+    void TextureAtlas::destroy(const Context& context, TextureAtlas& atlas) noexcept {
+        for (auto& page : atlas._pages) {
+            Image::destroy(context, page.image);
+        }
+        atlas._pages.clear();
+        atlas._queued.clear();
+    }
+
+    qz_nodiscard bool TextureAtlas::fits(std::uint32_t width, std::uint32_t height) const noexcept {
+        const auto mips = entry_mips(width, height);
+        return std::max(width, height) <= _threshold && std::max(rect_size(width, mips), rect_size(height, mips)) <= _size;
+    }
+
+    void TextureAtlas::enqueue(meta::Handle<StaticTexture> handle, const std::uint8_t* pixels, std::uint32_t width, std::uint32_t height) noexcept {
+        const auto mips = entry_mips(width, height);
+        const auto padded_width = rect_size(width, mips);
+        const auto padded_height = rect_size(height, mips);
+        std::vector<std::uint8_t> texels(rect_bytes(padded_width, padded_height, mips));
+
+        // Shaders tile packed textures with fract(), so the padding repeats the texture from the opposite edge.
+        // It fills the whole rectangle, neither filtering nor coarser mips bleed other textures in.
+        auto* level = texels.data();
+        for (std::uint32_t y = 0; y < padded_height; ++y) {
+            const auto source_y = (y + height - atlas_padding % height) % height;
+            for (std::uint32_t x = 0; x < padded_width; ++x) {
+                const auto source_x = (x + width - atlas_padding % width) % width;
+                std::memcpy(level + ((std::size_t)y * padded_width + x) * 4, pixels + ((std::size_t)source_y * width + source_x) * 4, 4);
+            }
+        }
+        for (std::uint32_t mip = 1; mip < mips; ++mip) {
+            auto* next = level + (std::size_t)(padded_width >> (mip - 1)) * (padded_height >> (mip - 1)) * 4;
+            stbir_resize_uint8_srgb(
+                level, padded_width >> (mip - 1), padded_height >> (mip - 1), 0,
+                next, padded_width >> mip, padded_height >> mip, 0,
+                4, 3, 0);
+            level = next;
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _queued.push_back({ handle, width, height, mips, std::move(texels) });
+    }
+
+    void TextureAtlas::flush(const Context& context) noexcept {
+        std::vector<Entry> queued;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            queued.swap(_queued);
+        }
+        qz_likely_if(queued.empty()) {
+            return;
+        }
+
+        std::size_t size = 0;
+        for (const auto& entry : queued) {
+            size += entry.texels.size();
+        }
+        auto staging = context.staging->allocate(context, size);
+
+        std::size_t offset = 0;
+        std::vector<std::vector<BufferImageCopy>> copies;
+        std::vector<std::pair<meta::Handle<StaticTexture>, StaticTexture>> finished;
+        finished.reserve(queued.size());
+        for (const auto& [handle, width, height, mips, texels] : queued) {
+            const auto padded_width = rect_size(width, mips);
+            const auto padded_height = rect_size(height, mips);
+            const auto [page, position] = _pack(context, padded_width, padded_height, 1u << (mips - 1));
+            copies.resize(_pages.size());
+
+            std::memcpy(static_cast<std::uint8_t*>(staging.mapped) + offset, texels.data(), texels.size());
+            for (std::uint32_t mip = 0; mip < mips; ++mip) {
+                copies[page].push_back({
+                    .source_off = staging.offset + offset,
+                    .dest_mip = mip,
+                    .dest_off = { position.x >> mip, position.y >> mip },
+                    .extent = { padded_width >> mip, padded_height >> mip }
+                });
+                offset += (std::size_t)(padded_width >> mip) * (padded_height >> mip) * 4;
+            }
+
+            const auto scale = 1.0f / _size;
+            finished.emplace_back(handle, StaticTexture::from_atlas(_pages[page].image, {
+                width * scale,
+                height * scale,
+                (position.x + atlas_padding) * scale,
+                (position.y + atlas_padding) * scale
+            }, (float)(mips - 1)));
+        }
+
+        // Pages are only touched on the graphics queue, barriers order the copies against frames sampling them.
+        const auto thread_index = context.task_manager->handle().GetCurrentThreadIndex();
+        auto& pool = *context.transient_pools[thread_index];
+        auto command_buffer = pool.acquire_command_buffer(context);
+        command_buffer.begin();
+        for (std::size_t i = 0; i < copies.size(); ++i) {
+            qz_unlikely_if(copies[i].empty()) {
+                continue;
+            }
+            auto& page = _pages[i];
+            command_buffer
+                .insert_layout_transition({
+                    .image = &page.image,
+                    .mip = 0,
+                    .levels = 0,
+                    .source_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                    .dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    .source_access = {},
+                    .dest_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+                    .old_layout = page.fresh ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                    .new_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+                })
+                .copy_buffer_to_image(staging.buffer, page.image, copies[i])
+                .insert_layout_transition({
+                    .image = &page.image,
+                    .mip = 0,
+                    .levels = 0,
+                    .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    .dest_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                    .source_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+                    .dest_access = VK_ACCESS_SHADER_READ_BIT,
+                    .old_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    .new_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                });
+            page.fresh = false;
+        }
+        command_buffer.end();
+
+        const auto done = pool.acquire_fence(context);
+        context.graphics->submit(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, nullptr, nullptr, done);
+        context.task_manager->insert(
+            [&context, done]() {
+                return vkGetFenceStatus(context.device, done);
+            },
+            [&context, thread_index, done, staging, command_buffer, finished = std::move(finished)]() mutable {
+                for (auto& [handle, texture] : finished) {
+                    assets::finalize(handle, std::move(texture));
+                }
+                auto& pool = *context.transient_pools[thread_index];
+                pool.recycle_fence(context, done);
+                pool.recycle_command_buffer(context, command_buffer);
+                context.staging->release(context, staging);
+            });
+    }
+
+    qz_nodiscard std::size_t TextureAtlas::queued() noexcept {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _queued.size();
+    }
+
+    // Best fitting shelf with room left on any page, then a new shelf, then a new page.
+    qz_nodiscard std::pair<std::uint32_t, VkOffset2D> TextureAtlas::_pack(const Context& context,
+                                                                           std::uint32_t width,
+                                                                           std::uint32_t height,
+                                                                           std::uint32_t alignment) noexcept {
+        const auto align = [alignment](std::uint32_t value) {
+            return (value + alignment - 1) & ~(alignment - 1);
+        };
+        for (std::uint32_t i = 0; i < _pages.size(); ++i) {
+            auto& page = _pages[i];
+            Shelf* best = nullptr;
+            for (auto& shelf : page.shelves) {
+                qz_unlikely_if(shelf.height >= height &&
+                               shelf.y % alignment == 0 &&
+                               align(shelf.x) + width <= _size &&
+                               (!best || shelf.height < best->height)) {
+                    best = &shelf;
+                }
+            }
+            qz_likely_if(best) {
+                const VkOffset2D position = { (std::int32_t)align(best->x), (std::int32_t)best->y };
+                best->x = align(best->x) + width;
+                return { i, position };
+            }
+            qz_likely_if(align(page.top) + height <= _size) {
+                page.shelves.push_back({ align(page.top), height, width });
+                page.top = page.shelves.back().y + height;
+                return { i, { 0, (std::int32_t)page.shelves.back().y } };
+            }
+        }
+        // Pages have a full mip chain, each entry only fills and samples as many levels as it has.
+        _pages.push_back({
+            .image = Image::create(context, {
+                .width = _size,
+                .height = _size,
+                .mips = (std::uint32_t)std::bit_width(_size),
+                .format = VK_FORMAT_R8G8B8A8_SRGB,
+                .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+            }),
+            .shelves = { { 0, height, width } },
+            .top = height,
+            .fresh = true
+        });
+        return { (std::uint32_t)_pages.size() - 1, { 0, 0 } };
+    }
+} // namespace qz::gfx
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <qz/gfx/static_texture.hpp>
+#include <qz/gfx/image.hpp>
+
+#include <qz/meta/types.hpp>
+
+#include <qz/util/macros.hpp>
+#include <qz/util/fwd.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <mutex>
+
+namespace qz::gfx {
+    // Packs small diffuse textures into shared atlas pages, so that they don't each pay for an image,
+    // an allocation and an upload submission. Pages are filled by a shelf packer, queued textures are
+    // uploaded with a single submission per tick and become ready once it completes.
+    class TextureAtlas {
+        struct Shelf {
+            std::uint32_t y;
+            std::uint32_t height;
+            std::uint32_t x;
+        };
+        struct Page {
+            Image image;
+            std::vector<Shelf> shelves;
+            std::uint32_t top;
+            bool fresh;
+        };
+        struct Entry {
+            meta::Handle<StaticTexture> handle;
+            std::uint32_t width;
+            std::uint32_t height;
+            std::uint32_t mips;
+            std::vector<std::uint8_t> texels;
+        };
+        std::vector<Page> _pages;
+        std::vector<Entry> _queued;
+        std::uint32_t _threshold;
+        std::uint32_t _size;
+        std::mutex _mutex;
+
+        qz_nodiscard std::pair<std::uint32_t, VkOffset2D> _pack(const Context&, std::uint32_t, std::uint32_t, std::uint32_t) noexcept;
+    public:
+        qz_nodiscard static std::unique_ptr<TextureAtlas> create(const Context&, const Settings&) noexcept;
+        static void destroy(const Context&, TextureAtlas&) noexcept;
+
+        qz_nodiscard bool fits(std::uint32_t, std::uint32_t) const noexcept;
+        void enqueue(meta::Handle<StaticTexture>, const std::uint8_t*, std::uint32_t, std::uint32_t) noexcept;
+        void flush(const Context&) noexcept;
+        qz_nodiscard std::size_t queued() noexcept;
+    };
+} // namespace qz::gfx
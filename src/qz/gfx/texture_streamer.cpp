@@ -0,0 +1,244 @@
+#include <qz/gfx/texture_streamer.hpp>
+#include <qz/gfx/deletion_queue.hpp>
+#include <qz/gfx/static_texture.hpp>
+#include <qz/gfx/context.hpp>
+#include <qz/gfx/assets.hpp>
+
+#include <qz/meta/constants.hpp>
+
+#include <algorithm>
+#include <optional>
+#include <cstring>
+#include <cmath>
+#include <bit>
+
+namespace qz::gfx {
+    // Textures that weren't sampled for this many frames are the first to lose their finer mips.
+    constexpr auto eviction_delay = 120u;
+    // Caps concurrent mip loads, so that the most wanted textures are always the next to be loaded.
+    constexpr auto max_streaming_loads = 4u;
+
+    qz_nodiscard static std::size_t texel_size(VkFormat format) noexcept {
+        switch (format) {
+            case VK_FORMAT_R8_UNORM:   return 1;
+            case VK_FORMAT_R8G8_UNORM: return 2;
+            default:                   return 4;
+        }
+    }
+
+    qz_nodiscard static std::size_t resident_size(const TextureResidency& residency, std::uint32_t base) noexcept {
+        std::size_t size = 0;
+        for (auto level = base; level < residency.mips; ++level) {
+            size += (std::size_t)std::max(residency.width >> level, 1u) * std::max(residency.height >> level, 1u) * texel_size(residency.format);
+        }
+        return size;
+    }
+
+    qz_nodiscard std::unique_ptr<TextureStreamer> TextureStreamer::create(const Context& context, const Settings& settings) noexcept {
+        auto streamer = std::make_unique<TextureStreamer>();
+        for (auto& feedback : streamer->_feedback) {
+            feedback = StaticBuffer::create(context, {
+                .flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                .usage = VMA_MEMORY_USAGE_GPU_TO_CPU,
+                .capacity = meta::max_textures * sizeof(std::uint32_t)
+            });
+            std::memset(feedback.mapped, 0xff, feedback.capacity);
+            vmaFlushAllocation(context.allocator, feedback.allocation, 0, VK_WHOLE_SIZE);
+        }
+        streamer->_budget = settings.texture_budget;
+        streamer->_tail = settings.texture_tail;
+        return streamer;
+    }
+
+    void TextureStreamer::destroy(const Context& context, TextureStreamer& streamer) noexcept {
+        for (auto& feedback : streamer._feedback) {
+            StaticBuffer::destroy(context, feedback);
+        }
+        streamer._records.clear();
+    }
+
+    void TextureStreamer::update(const Context& context, std::uint32_t frame) noexcept {
+        struct Request {
+            meta::Handle<StaticTexture> handle;
+            std::uint32_t level;
+        };
+        struct Load {
+            meta::Handle<StaticTexture> handle;
+            std::uint32_t level;
+            std::string path;
+            TextureKind kind;
+        };
+
+        auto& feedback = _feedback[frame];
+        auto* requested = static_cast<std::uint32_t*>(feedback.mapped);
+        vmaInvalidateAllocation(context.allocator, feedback.allocation, 0, VK_WHOLE_SIZE);
+
+        std::vector<Load> loads;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            ++_frame;
+
+            const auto issue = [&](std::size_t index, std::uint32_t level) {
+                auto& record = _records[index];
+                // The new mip range is allocated next to the current one, which is only freed after the load committed.
+                _resident += resident_size(record.residency, level);
+                _releasing += record.bytes;
+                record.pending = true;
+                ++_in_flight;
+                loads.push_back({ { index }, level, record.residency.path, record.residency.kind });
+            };
+
+            // Drops textures that went unused for a while back to their mip tail, least recently used first.
+            const auto evict = [&](std::size_t needed) {
+                std::vector<std::size_t> candidates;
+                for (std::size_t i = 0; i < _records.size(); ++i) {
+                    const auto& record = _records[i];
+                    qz_unlikely_if(!record.pending &&
+                                   record.residency.mips &&
+                                   record.last_used + eviction_delay < _frame &&
+                                   record.residency.base < tail_level(record.residency.mips)) {
+                        candidates.emplace_back(i);
+                    }
+                }
+                std::sort(candidates.begin(), candidates.end(), [this](const auto lhs, const auto rhs) {
+                    return _records[lhs].last_used < _records[rhs].last_used;
+                });
+
+                std::size_t freed = 0;
+                for (const auto index : candidates) {
+                    qz_unlikely_if(freed >= needed) {
+                        break;
+                    }
+                    const auto& record = _records[index];
+                    const auto tail = tail_level(record.residency.mips);
+                    freed += record.bytes - resident_size(record.residency, tail);
+                    issue(index, tail);
+                }
+            };
+
+            std::vector<Request> promotions;
+            for (std::size_t i = 0; i < std::min<std::size_t>(_records.size(), meta::max_textures); ++i) {
+                auto& record = _records[i];
+                qz_likely_if(requested[i] == ~0u || !record.residency.mips) {
+                    continue;
+                }
+                record.last_used = _frame;
+
+                // Feedback is the finest UV footprint the texture was sampled with, in texels it maps to a mip level.
+                const auto& residency = record.residency;
+                const auto texels = std::bit_cast<float>(requested[i]) * std::max(residency.width, residency.height);
+                qz_unlikely_if(!std::isfinite(texels)) {
+                    continue;
+                }
+                const auto level = texels > 1.0f ? std::min((std::uint32_t)std::log2(texels), residency.mips - 1) : 0u;
+                qz_unlikely_if(!record.pending && level < residency.base) {
+                    promotions.push_back({ { i }, level });
+                }
+            }
+            std::memset(requested, 0xff, feedback.capacity);
+            vmaFlushAllocation(context.allocator, feedback.allocation, 0, VK_WHOLE_SIZE);
+
+            // Textures furthest away from the detail they're sampled at go first.
+            std::sort(promotions.begin(), promotions.end(), [this](const auto& lhs, const auto& rhs) {
+                return _records[lhs.handle.index].residency.base - lhs.level >
+                       _records[rhs.handle.index].residency.base - rhs.level;
+            });
+            for (const auto& [handle, level] : promotions) {
+                qz_unlikely_if(_in_flight >= max_streaming_loads) {
+                    break;
+                }
+                const auto& record = _records[handle.index];
+                // Evicted memory only comes back once frames in flight stopped sampling it, promotions wait for that.
+                const auto projected = _resident + resident_size(record.residency, level);
+                qz_unlikely_if(projected > _budget) {
+                    qz_likely_if(projected - _budget > _releasing) {
+                        evict(projected - _budget - _releasing);
+                    }
+                    break;
+                }
+                issue(handle.index, level);
+            }
+
+            qz_unlikely_if(_resident > _budget + _releasing) {
+                evict(_resident - _budget - _releasing);
+            }
+        }
+
+        for (const auto& [handle, level, path, kind] : loads) {
+            StaticTexture::stream(context, handle, path, kind, level);
+        }
+    }
+
+    void TextureStreamer::commit(const Context& context,
+                                 meta::Handle<StaticTexture> handle,
+                                 const Image& image,
+                                 TextureResidency&& residency,
+                                 DecodedTexture&& decoded) noexcept {
+        std::optional<Image> retired;
+        {
+            const auto lock = assets::acquire<StaticTexture>();
+            qz_unlikely_if(assets::is_ready(handle)) {
+                retired = assets::from_handle(handle).image();
+            }
+        }
+        assets::finalize(handle, StaticTexture::from_raw(image));
+
+        std::size_t released = 0;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            qz_unlikely_if(_records.size() <= handle.index) {
+                _records.resize(handle.index + 1);
+            }
+            auto& record = _records[handle.index];
+            qz_likely_if(record.pending) {
+                record.pending = false;
+                --_in_flight;
+                released = record.bytes;
+            } else {
+                record.last_used = _frame;
+                _resident += resident_size(residency, residency.base);
+            }
+            record.bytes = resident_size(residency, residency.base);
+            // Decoded pixels are only worth their memory while there are levels left to stream in or out.
+            const auto streaming = residency.base != 0 && residency.base < tail_level(residency.mips);
+            record.decoded = streaming ? std::move(decoded) : DecodedTexture();
+            record.residency = std::move(residency);
+        }
+
+        qz_unlikely_if(retired) {
+            // Frames in flight may still sample the previous mip range, it stays resident until it's destroyed.
+            context.deletion_queue->push(*retired, [this, released]() {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _resident -= released;
+                _releasing -= released;
+            });
+        }
+    }
+
+    qz_nodiscard DecodedTexture TextureStreamer::decoded(meta::Handle<StaticTexture> handle) noexcept {
+        std::lock_guard<std::mutex> lock(_mutex);
+        qz_unlikely_if(_records.size() <= handle.index) {
+            return {};
+        }
+        return _records[handle.index].decoded;
+    }
+
+    qz_nodiscard std::uint32_t TextureStreamer::tail_level(std::uint32_t mips) const noexcept {
+        const auto tail_mips = (std::uint32_t)std::log2(std::max(_tail, 1u)) + 1;
+        return mips > tail_mips ? mips - tail_mips : 0;
+    }
+
+    qz_nodiscard std::uint32_t TextureStreamer::pending() noexcept {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _in_flight;
+    }
+
+    qz_nodiscard std::size_t TextureStreamer::resident() noexcept {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _resident;
+    }
+
+    qz_nodiscard Buffer<1> TextureStreamer::feedback(std::size_t index) const noexcept {
+        return Buffer<1>::from_raw(StaticBuffer(_feedback[index]), _feedback[index].capacity);
+    }
+} // namespace qz::gfx
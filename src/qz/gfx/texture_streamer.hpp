@@ -0,0 +1,72 @@
+#pragma once
+
+#include <qz/gfx/static_texture.hpp>
+#include <qz/gfx/static_buffer.hpp>
+#include <qz/gfx/buffer.hpp>
+#include <qz/gfx/image.hpp>
+
+#include <qz/meta/types.hpp>
+
+#include <qz/util/macros.hpp>
+#include <qz/util/fwd.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+
+namespace qz::gfx {
+    struct TextureResidency {
+        std::string path;
+        TextureKind kind;
+        VkFormat format;
+        std::uint32_t width;
+        std::uint32_t height;
+        std::uint32_t mips;
+        std::uint32_t base;
+    };
+
+    // Full resolution pixels kept between mip loads, so that each promotion doesn't decode the file again.
+    struct DecodedTexture {
+        std::shared_ptr<const std::uint8_t> pixels;
+        std::int32_t width;
+        std::int32_t height;
+        std::int32_t channels;
+    };
+
+    // Keeps textures resident at the mip level the fragment shader asks for, within a memory budget.
+    // Each frame the shader writes the finest UV footprint every texture was sampled with into a
+    // feedback buffer, which is read back once the frame's fence has been waited on.
+    class TextureStreamer {
+        struct Record {
+            TextureResidency residency;
+            DecodedTexture decoded;
+            std::size_t bytes;
+            std::uint64_t last_used;
+            bool pending;
+        };
+        meta::in_flight_array_t<StaticBuffer> _feedback;
+        std::vector<Record> _records;
+        std::size_t _resident;
+        std::size_t _releasing;
+        std::size_t _budget;
+        std::uint32_t _tail;
+        std::uint32_t _in_flight;
+        std::uint64_t _frame;
+        std::mutex _mutex;
+    public:
+        qz_nodiscard static std::unique_ptr<TextureStreamer> create(const Context&, const Settings&) noexcept;
+        static void destroy(const Context&, TextureStreamer&) noexcept;
+
+        void update(const Context&, std::uint32_t) noexcept;
+        void commit(const Context&, meta::Handle<StaticTexture>, const Image&, TextureResidency&&, DecodedTexture&&) noexcept;
+        qz_nodiscard DecodedTexture decoded(meta::Handle<StaticTexture>) noexcept;
+        qz_nodiscard std::uint32_t tail_level(std::uint32_t) const noexcept;
+        qz_nodiscard std::uint32_t pending() noexcept;
+        qz_nodiscard std::size_t resident() noexcept;
+        qz_nodiscard Buffer<1> feedback(std::size_t) const noexcept;
+    };
+} // namespace qz::gfx
@@ -0,0 +1,91 @@
+#include <qz/gfx/transfer_scheduler.hpp>
+#include <qz/gfx/context.hpp>
+#include <qz/gfx/queue.hpp>
+
+#include <utility>
+
+namespace qz::gfx {
+    qz_nodiscard std::unique_ptr<TransferScheduler> TransferScheduler::create(const Context& context) noexcept {
+        auto scheduler = std::make_unique<TransferScheduler>();
+        VkSemaphoreTypeCreateInfo type_info{};
+        type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        type_info.initialValue = 0;
+        VkSemaphoreCreateInfo semaphore_info{};
+        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphore_info.pNext = &type_info;
+        qz_vulkan_check(vkCreateSemaphore(context.device, &semaphore_info, nullptr, &scheduler->_timeline));
+        scheduler->_value = 0;
+        scheduler->_running = true;
+        // The context is returned by value, only the queue it points to is stable enough to hand to the thread.
+        scheduler->_thread = std::thread(&TransferScheduler::_run, scheduler.get(), std::ref(*context.transfer));
+        return scheduler;
+    }
+
+    void TransferScheduler::destroy(const Context& context, TransferScheduler& scheduler) noexcept {
+        {
+            std::lock_guard<std::mutex> lock(scheduler._mutex);
+            scheduler._running = false;
+        }
+        scheduler._condition.notify_one();
+        scheduler._thread.join();
+        vkDestroySemaphore(context.device, scheduler._timeline, nullptr);
+    }
+
+    qz_nodiscard std::uint64_t TransferScheduler::submit(const CommandBuffer& commands) noexcept {
+        std::uint64_t value;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            value = ++_value;
+            _queued.push_back({ commands, value });
+        }
+        _condition.notify_one();
+        return value;
+    }
+
+    qz_nodiscard std::uint64_t TransferScheduler::completed(const Context& context) const noexcept {
+        std::uint64_t value;
+        qz_vulkan_check(vkGetSemaphoreCounterValue(context.device, _timeline, &value));
+        return value;
+    }
+
+    // Waits for everything submitted so far, without touching the queue the scheduler thread submits to.
+    void TransferScheduler::wait_idle(const Context& context) noexcept {
+        std::uint64_t value;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            value = _value;
+        }
+        VkSemaphoreWaitInfo wait_info{};
+        wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        wait_info.semaphoreCount = 1;
+        wait_info.pSemaphores = &_timeline;
+        wait_info.pValues = &value;
+        qz_vulkan_check(vkWaitSemaphores(context.device, &wait_info, -1));
+    }
+
+    qz_nodiscard VkSemaphore TransferScheduler::timeline() const noexcept {
+        return _timeline;
+    }
+
+    // Values are handed out and queued under the same lock, so they reach the queue in increasing order.
+    void TransferScheduler::_run(Queue& queue) noexcept {
+        std::vector<Submission> submissions;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(_mutex);
+                _condition.wait(lock, [this]() {
+                    return !_queued.empty() || !_running;
+                });
+                qz_unlikely_if(_queued.empty()) {
+                    return;
+                }
+                submissions.swap(_queued);
+            }
+            for (const auto& [commands, value] : submissions) {
+                queue.submit(commands, {}, nullptr, 0, _timeline, value, nullptr);
+            }
+            submissions.clear();
+        }
+    }
+} // namespace qz::gfx
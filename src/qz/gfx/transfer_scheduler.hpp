@@ -0,0 +1,43 @@
+#pragma once
+
+#include <qz/gfx/command_buffer.hpp>
+
+#include <qz/util/macros.hpp>
+#include <qz/util/fwd.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <mutex>
+
+namespace qz::gfx {
+    // Sole submitter to the transfer queue, from a thread of its own. Every submission signals the next
+    // value of one timeline semaphore, so consumers wait on a value and readiness is a counter query.
+    class TransferScheduler {
+        struct Submission {
+            CommandBuffer commands;
+            std::uint64_t value;
+        };
+        std::vector<Submission> _queued;
+        VkSemaphore _timeline;
+        std::uint64_t _value;
+        std::thread _thread;
+        std::condition_variable _condition;
+        std::mutex _mutex;
+        bool _running;
+
+        void _run(Queue&) noexcept;
+    public:
+        qz_nodiscard static std::unique_ptr<TransferScheduler> create(const Context&) noexcept;
+        static void destroy(const Context&, TransferScheduler&) noexcept;
+
+        qz_nodiscard std::uint64_t submit(const CommandBuffer&) noexcept;
+        qz_nodiscard std::uint64_t completed(const Context&) const noexcept;
+        void wait_idle(const Context&) noexcept;
+        qz_nodiscard VkSemaphore timeline() const noexcept;
+    };
+} // namespace qz::gfx
@@ -0,0 +1,110 @@
+#include <qz/gfx/transform_store.hpp>
+#include <qz/gfx/command_buffer.hpp>
+#include <qz/gfx/context.hpp>
+
+#include <cstring>
+
+namespace qz::gfx {
+    // Matches the scatter shader's workgroup size.
+    constexpr auto scatter_group_size = 64u;
+
+    qz_nodiscard TransformStore TransformStore::create(const Context& context, Renderer& renderer) noexcept {
+        TransformStore store{};
+        store._scatter = Pipeline::create(context, renderer, Pipeline::ComputeCreateInfo{
+            .compute = "data/shaders/scatter.comp.spv"
+        });
+        store._sets = DescriptorSet<>::allocate(context, store._scatter.set(0));
+        for (auto& updates : store._updates) {
+            updates = GpuVector<TransformUpdate>::create(context, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_CPU_TO_GPU);
+        }
+        store._transforms = GpuVector<glm::mat4>::create(context, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VMA_MEMORY_USAGE_GPU_ONLY);
+        return store;
+    }
+
+    void TransformStore::destroy(const Context& context, TransformStore& store) noexcept {
+        GpuVector<glm::mat4>::destroy(context, store._transforms);
+        for (auto& updates : store._updates) {
+            GpuVector<TransformUpdate>::destroy(context, updates);
+        }
+        DescriptorSet<>::destroy(context, store._sets);
+        Pipeline::destroy(context, store._scatter);
+        store = {};
+    }
+
+    void TransformStore::_mark(std::uint32_t index) noexcept {
+        qz_likely_if(!_marked[index]) {
+            _marked[index] = true;
+            _dirty.emplace_back(index);
+        }
+    }
+
+    qz_nodiscard std::uint32_t TransformStore::insert(const glm::mat4& value) noexcept {
+        const auto index = (std::uint32_t)_values.size();
+        _values.emplace_back(value);
+        _marked.emplace_back(false);
+        _mark(index);
+        return index;
+    }
+
+    // Writing back an unchanged transform costs nothing, static instances never leave the CPU again.
+    void TransformStore::update(std::uint32_t index, const glm::mat4& value) noexcept {
+        qz_likely_if(std::memcmp(&_values[index], &value, sizeof(glm::mat4)) == 0) {
+            return;
+        }
+        _values[index] = value;
+        _mark(index);
+    }
+
+    // Records outside of any render pass, before the frame's draws read the transforms.
+    void TransformStore::flush(const Context& context, CommandBuffer& command_buffer, std::uint32_t frame) noexcept {
+        _transforms.resize(context, command_buffer, _values.size());
+        qz_likely_if(_dirty.empty()) {
+            return;
+        }
+
+        auto& updates = _updates[frame];
+        updates.resize(context, _dirty.size());
+        for (std::size_t i = 0; i < _dirty.size(); ++i) {
+            const auto index = _dirty[i];
+            updates[i] = { _values[index], index };
+            _marked[index] = false;
+        }
+        const auto count = (std::uint32_t)_dirty.size();
+        _dirty.clear();
+
+        auto& set = _sets[frame];
+        DescriptorSet<1>::bind(context, set, _scatter["Updates"], updates.info());
+        DescriptorSet<1>::bind(context, set, _scatter["Transforms"], _transforms.info());
+        command_buffer
+            .insert_buffer_barrier({
+                .buffer = &_transforms.buffer(),
+                .source_stage = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                .dest_stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                .source_access = {},
+                .dest_access = VK_ACCESS_SHADER_WRITE_BIT
+            })
+            .bind_pipeline(_scatter)
+            .bind_descriptor_set(set)
+            .push_constants(VK_SHADER_STAGE_COMPUTE_BIT, sizeof(count), &count)
+            .dispatch((count + scatter_group_size - 1) / scatter_group_size, 1, 1)
+            .insert_buffer_barrier({
+                .buffer = &_transforms.buffer(),
+                .source_stage = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                .dest_stage = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT,
+                .source_access = VK_ACCESS_SHADER_WRITE_BIT,
+                .dest_access = VK_ACCESS_SHADER_READ_BIT
+            });
+    }
+
+    qz_nodiscard const glm::mat4& TransformStore::operator [](std::uint32_t index) const noexcept {
+        return _values[index];
+    }
+
+    qz_nodiscard std::size_t TransformStore::size() const noexcept {
+        return _values.size();
+    }
+
+    qz_nodiscard VkDescriptorBufferInfo TransformStore::info() const noexcept {
+        return _transforms.info();
+    }
+} // namespace qz::gfx
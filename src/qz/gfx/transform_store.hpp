@@ -0,0 +1,46 @@
+#pragma once
+
+#include <qz/gfx/descriptor_set.hpp>
+#include <qz/gfx/gpu_vector.hpp>
+#include <qz/gfx/pipeline.hpp>
+
+#include <qz/meta/types.hpp>
+
+#include <qz/util/macros.hpp>
+#include <qz/util/fwd.hpp>
+
+#include <glm/mat4x4.hpp>
+
+#include <cstdint>
+#include <vector>
+
+namespace qz::gfx {
+    struct alignas(16) TransformUpdate {
+        glm::mat4 value;
+        std::uint32_t index;
+    };
+
+    // Instance transforms kept in a device local buffer. Only the transforms changed since the last flush are
+    // uploaded, as index and value pairs in the frame slot's update buffer, and scattered in place by a compute pass.
+    class TransformStore {
+        Pipeline _scatter;
+        DescriptorSet<> _sets;
+        meta::in_flight_array_t<GpuVector<TransformUpdate>> _updates;
+        GpuVector<glm::mat4> _transforms;
+        std::vector<glm::mat4> _values;
+        std::vector<std::uint32_t> _dirty;
+        std::vector<bool> _marked;
+
+        void _mark(std::uint32_t) noexcept;
+    public:
+        qz_nodiscard static TransformStore create(const Context&, Renderer&) noexcept;
+        static void destroy(const Context&, TransformStore&) noexcept;
+
+        qz_nodiscard std::uint32_t insert(const glm::mat4&) noexcept;
+        void update(std::uint32_t, const glm::mat4&) noexcept;
+        void flush(const Context&, CommandBuffer&, std::uint32_t) noexcept;
+        qz_nodiscard const glm::mat4& operator [](std::uint32_t) const noexcept;
+        qz_nodiscard std::size_t size() const noexcept;
+        qz_nodiscard VkDescriptorBufferInfo info() const noexcept;
+    };
+} // namespace qz::gfx
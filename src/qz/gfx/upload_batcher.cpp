@@ -0,0 +1,324 @@
+#include <qz/gfx/transfer_scheduler.hpp>
+#include <qz/gfx/command_buffer.hpp>
+#include <qz/gfx/upload_batcher.hpp>
+#include <qz/gfx/task_manager.hpp>
+#include <qz/gfx/context.hpp>
+#include <qz/gfx/queue.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <utility>
+#include <chrono>
+#include <array>
+
+namespace qz::gfx {
+    // Mip generation is charged as another third of the image, on top of its copy.
+    qz_nodiscard static std::size_t upload_size(const UploadRequest& request) noexcept {
+        std::size_t size = 0;
+        for (const auto& buffer : request.buffers) {
+            size += buffer.dest.capacity;
+        }
+        for (const auto& image : request.images) {
+            size += image.size + image.size / 3;
+        }
+        return size;
+    }
+
+    qz_nodiscard std::unique_ptr<UploadBatcher> UploadBatcher::create(const Context& context, const Settings& settings) noexcept {
+        auto batcher = std::make_unique<UploadBatcher>();
+        VkSemaphoreTypeCreateInfo type_info{};
+        type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        type_info.initialValue = 0;
+        VkSemaphoreCreateInfo semaphore_info{};
+        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphore_info.pNext = &type_info;
+        qz_vulkan_check(vkCreateSemaphore(context.device, &semaphore_info, nullptr, &batcher->_timeline));
+        batcher->_pending_bytes = 0;
+        batcher->_budget = settings.upload_budget;
+        batcher->_time_budget = settings.upload_time_budget;
+        batcher->_enqueued = 0;
+        batcher->_flushed = 0;
+        return batcher;
+    }
+
+    void UploadBatcher::destroy(const Context& context, UploadBatcher& batcher) noexcept {
+        vkDestroySemaphore(context.device, batcher._timeline, nullptr);
+        batcher._pending.clear();
+    }
+
+    qz_nodiscard std::uint64_t UploadBatcher::enqueue(UploadRequest&& request) noexcept {
+        const auto size = upload_size(request);
+        std::lock_guard<std::mutex> lock(_mutex);
+        _pending.emplace_back(std::move(request));
+        _pending_bytes += size;
+        // Batches take requests in order and signal how many were taken so far, so a request's number is the value to wait for.
+        return ++_enqueued;
+    }
+
+    // Copies the request, with the barriers handing the results over to the graphics queue. When both queues
+    // share a family there is nothing to hand over, plain barriers order the copies against the mip blits instead.
+    static void record_copies(const Context& context, CommandBuffer& command_buffer, const UploadRequest& request, bool shared) noexcept {
+        for (const auto& [source, offset, dest, stage, access] : request.buffers) {
+            command_buffer.copy_buffer(source, dest, offset, dest.capacity);
+            if (shared) {
+                command_buffer.insert_buffer_barrier({
+                    .buffer = &dest,
+                    .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    .dest_stage = stage,
+                    .source_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+                    .dest_access = access
+                });
+            } else {
+                command_buffer.transfer_ownership({
+                    .buffer = &dest,
+                    .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    .dest_stage = stage,
+                    .source_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+                    .dest_access = {}
+                }, *context.transfer, *context.graphics);
+            }
+        }
+        for (const auto& [source, offset, image, size] : request.images) {
+            command_buffer
+                .insert_layout_transition({
+                    .image = &image,
+                    .mip = 0,
+                    .levels = 0,
+                    .source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                    .dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    .source_access = {},
+                    .dest_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+                    .old_layout = VK_IMAGE_LAYOUT_UNDEFINED,
+                    .new_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+                })
+                .copy_buffer_to_image(source, image, std::array{ BufferImageCopy{
+                    .source_off = offset,
+                    .dest_mip = 0,
+                    .dest_off = { 0, 0 },
+                    .extent = { image.width, image.height }
+                } });
+            if (shared) {
+                command_buffer.insert_layout_transition({
+                    .image = &image,
+                    .mip = 0,
+                    .levels = 0,
+                    .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    .dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    .source_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+                    .dest_access = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+                    .old_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    .new_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                });
+            } else {
+                command_buffer.transfer_ownership({
+                    .image = &image,
+                    .mip = 0,
+                    .levels = 0,
+                    .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    .dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    .source_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+                    .dest_access = {},
+                    .old_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    .new_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                }, *context.transfer, *context.graphics);
+            }
+        }
+    }
+
+    static void record_acquires(const Context& context, CommandBuffer& command_buffer, const UploadRequest& request) noexcept {
+        for (const auto& [source, offset, dest, stage, access] : request.buffers) {
+            command_buffer.transfer_ownership({
+                .buffer = &dest,
+                .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                .dest_stage = stage,
+                .source_access = {},
+                .dest_access = access
+            }, *context.transfer, *context.graphics);
+        }
+        for (const auto& [source, offset, image, size] : request.images) {
+            command_buffer.transfer_ownership({
+                .image = &image,
+                .mip = 0,
+                .levels = 0,
+                .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                .dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                .source_access = {},
+                .dest_access = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+                .old_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                .new_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+            }, *context.transfer, *context.graphics);
+        }
+    }
+
+    // Blits every mip from the one above it, then leaves the whole image ready for sampling.
+    static void record_mips(CommandBuffer& command_buffer, const UploadRequest& request) noexcept {
+        for (const auto& [source, offset, image, size] : request.images) {
+            for (std::uint32_t mip = 1; mip < image.mips; ++mip) {
+                command_buffer
+                    .insert_layout_transition({
+                        .image = &image,
+                        .mip = mip,
+                        .levels = 1,
+                        .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                        .dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                        .source_access = {},
+                        .dest_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+                        .old_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                        .new_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+                    })
+                    .blit_image({
+                        .source_image = &image,
+                        .dest_image = nullptr,
+                        .source_off = {
+                            (std::int32_t)image.width >> (mip - 1),
+                            (std::int32_t)image.height >> (mip - 1),
+                            1
+                        },
+                        .dest_off = {
+                            (std::int32_t)image.width >> mip,
+                            (std::int32_t)image.height >> mip,
+                            1
+                        },
+                        .source_mip = mip - 1,
+                        .dest_mip = mip
+                    });
+                if (mip != image.mips - 1) {
+                    command_buffer.insert_layout_transition({
+                        .image = &image,
+                        .mip = mip,
+                        .levels = 1,
+                        .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                        .dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                        .source_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+                        .dest_access = VK_ACCESS_TRANSFER_READ_BIT,
+                        .old_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        .new_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+                    });
+                } else {
+                    command_buffer.insert_layout_transition({
+                        .image = &image,
+                        .mip = mip,
+                        .levels = 1,
+                        .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                        .dest_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                        .source_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+                        .dest_access = VK_ACCESS_SHADER_READ_BIT,
+                        .old_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        .new_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                    });
+                }
+            }
+            command_buffer.insert_layout_transition({
+                .image = &image,
+                .mip = 0,
+                .levels = std::max(image.mips - 1, 1u),
+                .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                .dest_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                .source_access = VK_ACCESS_TRANSFER_READ_BIT,
+                .dest_access = VK_ACCESS_SHADER_READ_BIT,
+                .old_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                .new_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+            });
+        }
+    }
+
+    void UploadBatcher::flush(const Context& context) noexcept {
+        std::deque<UploadRequest> pending;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            qz_likely_if(_pending.empty()) {
+                return;
+            }
+            pending.swap(_pending);
+        }
+
+        // A single graphics submission does everything when there is no dedicated transfer family.
+        const auto start = std::chrono::steady_clock::now();
+        // Batches are recycled by the task manager's tick, on the same thread that flushes them.
+        const auto shared = context.transfer->family() == context.graphics->family();
+        const auto thread_index = context.task_manager->handle().GetCurrentThreadIndex();
+        auto graphics_cmd = context.transient_pools[thread_index]->acquire_command_buffer(context);
+        graphics_cmd.begin();
+        CommandBuffer transfer_cmd{};
+        if (!shared) {
+            transfer_cmd = context.transfer_pools[thread_index]->acquire_command_buffer(context);
+            transfer_cmd.begin();
+        }
+
+        // Records requests in order until either budget runs out, the first one always goes so that
+        // requests larger than the budget still make progress.
+        std::size_t bytes = 0;
+        std::uint64_t recorded = 0;
+        for (; !pending.empty(); pending.pop_front()) {
+            const auto& request = pending.front();
+            const auto size = upload_size(request);
+            const auto elapsed = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+            qz_unlikely_if(recorded != 0 && ((_budget != 0 && bytes + size > _budget) || (_time_budget != 0 && elapsed >= _time_budget))) {
+                break;
+            }
+            if (shared) {
+                record_copies(context, graphics_cmd, request, true);
+            } else {
+                record_copies(context, transfer_cmd, request, false);
+                record_acquires(context, graphics_cmd, request);
+            }
+            record_mips(graphics_cmd, request);
+            bytes += size;
+            ++recorded;
+        }
+        graphics_cmd.end();
+
+        // Requests left over go back in front of the ones enqueued meanwhile, batches stay in request order.
+        std::uint64_t value;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _pending.insert(_pending.begin(), std::make_move_iterator(pending.begin()), std::make_move_iterator(pending.end()));
+            _pending_bytes -= bytes;
+            _flushed += recorded;
+            value = _flushed;
+        }
+
+        if (shared) {
+            context.graphics->submit(graphics_cmd, {}, nullptr, 0, _timeline, value, nullptr);
+            context.task_manager->insert(
+                [this, &context, value]() {
+                    return is_complete(context, value) ? VK_SUCCESS : VK_NOT_READY;
+                },
+                [&context, thread_index, graphics_cmd]() mutable {
+                    context.transient_pools[thread_index]->recycle_command_buffer(context, graphics_cmd);
+                });
+            return;
+        }
+        transfer_cmd.end();
+
+        // Graphics may be submitted before the scheduler thread got to the transfer half, timelines allow waiting ahead of the signal.
+        const auto transfer_value = context.transfer_scheduler->submit(transfer_cmd);
+        context.graphics->submit(graphics_cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, context.transfer_scheduler->timeline(), transfer_value, _timeline, value, nullptr);
+        context.task_manager->insert(
+            [this, &context, value]() {
+                return is_complete(context, value) ? VK_SUCCESS : VK_NOT_READY;
+            },
+            [&context, thread_index, transfer_cmd, graphics_cmd]() mutable {
+                context.transient_pools[thread_index]->recycle_command_buffer(context, graphics_cmd);
+                context.transfer_pools[thread_index]->recycle_command_buffer(context, transfer_cmd);
+            });
+    }
+
+    qz_nodiscard bool UploadBatcher::is_complete(const Context& context, std::uint64_t value) const noexcept {
+        std::uint64_t completed;
+        qz_vulkan_check(vkGetSemaphoreCounterValue(context.device, _timeline, &completed));
+        return completed >= value;
+    }
+
+    qz_nodiscard UploadBacklog UploadBatcher::backlog(const Context& context) noexcept {
+        std::uint64_t completed;
+        qz_vulkan_check(vkGetSemaphoreCounterValue(context.device, _timeline, &completed));
+        std::lock_guard<std::mutex> lock(_mutex);
+        return {
+            .requests = _pending.size(),
+            .bytes = _pending_bytes,
+            .in_flight = _flushed - completed
+        };
+    }
+} // namespace qz::gfx
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <qz/gfx/static_buffer.hpp>
+#include <qz/gfx/image.hpp>
+
+#include <qz/util/macros.hpp>
+#include <qz/util/fwd.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <deque>
+#include <mutex>
+
+namespace qz::gfx {
+    struct BufferUpload {
+        StaticBuffer source;
+        std::size_t offset;
+        StaticBuffer dest;
+        VkPipelineStageFlags stage;
+        VkAccessFlags access;
+    };
+
+    // Uploads the first mip of the image, the others are blitted from it.
+    struct ImageUpload {
+        StaticBuffer source;
+        std::size_t offset;
+        Image dest;
+        std::size_t size;
+    };
+
+    struct UploadRequest {
+        std::vector<BufferUpload> buffers;
+        std::vector<ImageUpload> images;
+    };
+
+    struct UploadBacklog {
+        std::size_t requests;
+        std::size_t bytes;
+        std::uint64_t in_flight;
+    };
+
+    // Collects uploads from every loader and records them into one transfer and one graphics
+    // command buffer per tick, within a byte and a recording time budget. The graphics half waits
+    // on the transfer timeline and signals a timeline of its own, counting the requests it covers.
+    class UploadBatcher {
+        std::deque<UploadRequest> _pending;
+        std::size_t _pending_bytes;
+        std::size_t _budget;
+        float _time_budget;
+        VkSemaphore _timeline;
+        std::uint64_t _enqueued;
+        std::uint64_t _flushed;
+        std::mutex _mutex;
+    public:
+        qz_nodiscard static std::unique_ptr<UploadBatcher> create(const Context&, const Settings&) noexcept;
+        static void destroy(const Context&, UploadBatcher&) noexcept;
+
+        qz_nodiscard std::uint64_t enqueue(UploadRequest&&) noexcept;
+        void flush(const Context&) noexcept;
+        qz_nodiscard bool is_complete(const Context&, std::uint64_t) const noexcept;
+        qz_nodiscard UploadBacklog backlog(const Context&) noexcept;
+    };
+} // namespace qz::gfx
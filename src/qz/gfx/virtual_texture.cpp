@@ -0,0 +1,464 @@
+#include <qz/gfx/virtual_texture.hpp>
+#include <qz/gfx/command_buffer.hpp>
+#include <qz/gfx/io_pool.hpp>
+#include <qz/gfx/context.hpp>
+#include <qz/gfx/assets.hpp>
+
+#include <qz/meta/constants.hpp>
+
+#include <algorithm>
+#include <optional>
+#include <cstring>
+#include <cstdio>
+#include <utility>
+#include <chrono>
+#include <thread>
+#include <bit>
+
+namespace qz::gfx {
+    // Pages sampled within this many frames are never evicted, so that pages on screen can't thrash each other.
+    constexpr auto cooling_frames = 8u;
+    // Caps concurrent page loads and page uploads recorded per frame.
+    constexpr auto max_page_loads = 16u;
+    constexpr auto max_page_uploads = 16u;
+    // Space reserved in each frame's staging buffer for rewritten indirection textures.
+    constexpr auto max_indirection_size = 1u << 20;
+    // Indirection entries store the atlas page's coordinates in 8 bits each.
+    constexpr auto max_atlas_pages = 256u;
+
+    // Mirrors "VirtualInfo" in the fragment shader, zeroed until the indirection texture is first uploaded.
+    struct VirtualInfo {
+        std::uint32_t indirection;
+        std::uint32_t atlas;
+        std::uint32_t pages_x;
+        std::uint32_t pages_y;
+        std::uint32_t mips;
+        std::uint32_t first_page;
+        std::uint32_t atlas_pages;
+        std::uint32_t page_size;
+        std::uint32_t page_border;
+    };
+
+    qz_nodiscard static std::uint32_t level_size(std::uint32_t pages, std::uint32_t mip) noexcept {
+        return std::max(pages >> mip, 1u);
+    }
+
+    qz_nodiscard static std::uint32_t level_offset(std::uint32_t pages_x, std::uint32_t pages_y, std::uint32_t mip) noexcept {
+        std::uint32_t offset = 0;
+        for (std::uint32_t level = 0; level < mip; ++level) {
+            offset += level_size(pages_x, level) * level_size(pages_y, level);
+        }
+        return offset;
+    }
+
+    qz_nodiscard std::unique_ptr<VirtualTextureCache> VirtualTextureCache::create(const Context& context, const Settings& settings) noexcept {
+        auto cache = std::make_unique<VirtualTextureCache>();
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(context.gpu, &properties);
+        cache->_page_size = settings.virtual_page_size;
+        cache->_page_border = settings.virtual_page_border;
+        cache->_padded_page = settings.virtual_page_size + 2 * settings.virtual_page_border;
+        cache->_page_bytes = (std::size_t)cache->_padded_page * cache->_padded_page * 4;
+        cache->_atlas_pages = std::min({
+            settings.virtual_atlas_pages,
+            max_atlas_pages,
+            properties.limits.maxImageDimension2D / cache->_padded_page
+        });
+        qz_unlikely_if(cache->_atlas_pages != settings.virtual_atlas_pages) {
+            std::printf("Virtual texture atlas clamped to %u pages per side\n", cache->_atlas_pages);
+        }
+        for (std::size_t i = 0; i < meta::max_in_flight; ++i) {
+            cache->_feedback[i] = StaticBuffer::create(context, {
+                .flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                .usage = VMA_MEMORY_USAGE_GPU_TO_CPU,
+                .capacity = meta::max_virtual_pages / 8
+            });
+            std::memset(cache->_feedback[i].mapped, 0, cache->_feedback[i].capacity);
+            vmaFlushAllocation(context.allocator, cache->_feedback[i].allocation, 0, VK_WHOLE_SIZE);
+            cache->_staging[i] = StaticBuffer::create(context, {
+                .flags = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                .usage = VMA_MEMORY_USAGE_CPU_ONLY,
+                .capacity = max_page_uploads * cache->_page_bytes + max_indirection_size
+            });
+            cache->_info[i] = StaticBuffer::create(context, {
+                .flags = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                .usage = VMA_MEMORY_USAGE_CPU_TO_GPU,
+                .capacity = meta::max_virtual_textures * sizeof(VirtualInfo)
+            });
+            std::memset(cache->_info[i].mapped, 0, cache->_info[i].capacity);
+            vmaFlushAllocation(context.allocator, cache->_info[i].allocation, 0, VK_WHOLE_SIZE);
+        }
+        cache->_slots.resize(cache->_atlas_pages * cache->_atlas_pages, { ~0u, 0, false, false });
+        cache->_fresh = true;
+        return cache;
+    }
+
+    void VirtualTextureCache::destroy(const Context& context, VirtualTextureCache& cache) noexcept {
+        while (cache.pending() != 0) {
+            using namespace std::literals;
+            std::this_thread::sleep_for(1ms);
+        }
+        for (std::size_t i = 0; i < meta::max_in_flight; ++i) {
+            StaticBuffer::destroy(context, cache._feedback[i]);
+            StaticBuffer::destroy(context, cache._staging[i]);
+            StaticBuffer::destroy(context, cache._info[i]);
+        }
+        // Atlas and indirection textures are owned by the asset storage.
+        for (auto& texture : cache._textures) {
+            util::FileView::destroy(texture.file);
+        }
+        cache._textures.clear();
+        cache._completed.clear();
+    }
+
+    qz_nodiscard std::optional<std::uint32_t> VirtualTextureCache::request(const Context& context, std::string_view path) noexcept {
+        auto file = util::FileView::create(path);
+        const auto reject = [&file, path](const char* reason) {
+            std::printf("Rejected virtual texture %.*s: %s\n", (int)path.size(), path.data(), reason);
+            util::FileView::destroy(file);
+            return std::nullopt;
+        };
+        qz_unlikely_if(file.size() < sizeof(VirtualTextureHeader)) {
+            return reject("truncated header");
+        }
+        VirtualTextureHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+        qz_unlikely_if(std::memcmp(header.magic, "QVT1", 4) != 0) {
+            return reject("not a virtual texture");
+        }
+        qz_unlikely_if(header.page_size != _page_size || header.border != _page_border) {
+            return reject("mismatched page size");
+        }
+        qz_unlikely_if(header.pages_x == 0 || header.pages_y == 0 || (std::uint64_t)header.pages_x * header.pages_y > meta::max_virtual_pages) {
+            return reject("page count out of range");
+        }
+        qz_unlikely_if(header.mips != (std::uint32_t)std::bit_width(std::max(header.pages_x, header.pages_y))) {
+            return reject("coarsest mip must be a single page");
+        }
+        const auto pages = level_offset(header.pages_x, header.pages_y, header.mips);
+        qz_unlikely_if(pages * sizeof(std::uint32_t) > max_indirection_size) {
+            return reject("virtual texture too large");
+        }
+        qz_unlikely_if(file.size() < sizeof(VirtualTextureHeader) + pages * _page_bytes) {
+            return reject("truncated pages");
+        }
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        qz_unlikely_if(_textures.size() >= meta::max_virtual_textures) {
+            return reject("too many virtual textures");
+        }
+        qz_unlikely_if(_page_slots.size() + pages > meta::max_virtual_pages) {
+            return reject("too many virtual pages");
+        }
+        // The coarsest page is the fallback for every other one, it stays resident.
+        const auto slot = _acquire_slot();
+        qz_unlikely_if(slot == ~0u) {
+            return reject("virtual texture atlas is full");
+        }
+
+        auto indirection = Image::create(context, {
+            .width = header.pages_x,
+            .height = header.pages_y,
+            .mips = header.mips,
+            .format = VK_FORMAT_R8G8B8A8_UNORM,
+            .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+        });
+        const auto handle = assets::emplace_empty<StaticTexture>();
+        assets::finalize(handle, StaticTexture::from_raw(indirection));
+        qz_unlikely_if(_textures.empty()) {
+            // The atlas is made on first use, the default texture must be the first one allocated.
+            _atlas = Image::create(context, {
+                .width = _atlas_pages * _padded_page,
+                .height = _atlas_pages * _padded_page,
+                .mips = 1,
+                .format = VK_FORMAT_R8G8B8A8_SRGB,
+                .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT
+            });
+            _atlas_handle = assets::emplace_empty<StaticTexture>();
+            assets::finalize(_atlas_handle, StaticTexture::from_raw(_atlas));
+        }
+        const auto index = (std::uint32_t)_textures.size();
+        const auto first_page = (std::uint32_t)_page_slots.size();
+        _textures.push_back({
+            .file = file,
+            .handle = handle,
+            .indirection = indirection,
+            .pages_x = header.pages_x,
+            .pages_y = header.pages_y,
+            .mips = header.mips,
+            .first_page = first_page,
+            .dirty = true,
+            .fresh = true
+        });
+        _page_slots.resize(first_page + pages, ~0u);
+        _issue(context, first_page + pages - 1, slot, true);
+        return meta::virtual_texture_bit | index;
+    }
+
+    void VirtualTextureCache::update(const Context& context, std::uint32_t frame) noexcept {
+        std::lock_guard<std::mutex> lock(_mutex);
+        // Nothing was requested, so no shader could have written feedback.
+        qz_likely_if(_textures.empty()) {
+            return;
+        }
+        auto& feedback = _feedback[frame];
+        auto* requested = static_cast<std::uint32_t*>(feedback.mapped);
+        vmaInvalidateAllocation(context.allocator, feedback.allocation, 0, VK_WHOLE_SIZE);
+        ++_frame;
+        std::vector<std::pair<std::uint32_t, std::uint32_t>> requests;
+        const auto words = (_page_slots.size() + 31) / 32;
+        for (std::size_t i = 0; i < words; ++i) {
+            qz_likely_if(requested[i] == 0) {
+                continue;
+            }
+            for (auto bits = std::exchange(requested[i], 0); bits != 0; bits &= bits - 1) {
+                const auto page = (std::uint32_t)(i * 32 + std::countr_zero(bits));
+                const auto slot = _page_slots[page];
+                qz_likely_if(slot != ~0u) {
+                    _slots[slot].last_used = _frame;
+                } else {
+                    requests.emplace_back(_locate(page) & 0xffffu, page);
+                }
+            }
+        }
+        vmaFlushAllocation(context.allocator, feedback.allocation, 0, VK_WHOLE_SIZE);
+
+        // Coarser pages first, they cover more of the screen and become the fallback of finer ones.
+        std::sort(requests.begin(), requests.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.first > rhs.first;
+        });
+        for (const auto& [_, page] : requests) {
+            qz_unlikely_if(_in_flight >= max_page_loads) {
+                break;
+            }
+            const auto slot = _acquire_slot();
+            qz_unlikely_if(slot == ~0u) {
+                break;
+            }
+            _issue(context, page, slot, false);
+        }
+    }
+
+    void VirtualTextureCache::record(const Context& context, CommandBuffer& command_buffer, std::uint32_t frame) noexcept {
+        std::lock_guard<std::mutex> lock(_mutex);
+        qz_likely_if(_textures.empty()) {
+            return;
+        }
+        auto& staging = _staging[frame];
+        auto* mapped = static_cast<std::uint8_t*>(staging.mapped);
+
+        std::size_t offset = 0;
+        std::vector<BufferImageCopy> copies;
+        const auto uploads = std::min<std::size_t>(_completed.size(), max_page_uploads);
+        for (std::size_t i = 0; i < uploads; ++i) {
+            const auto& [slot, texels] = _completed[i];
+            std::memcpy(mapped + offset, texels.data(), _page_bytes);
+            copies.push_back({
+                .source_off = offset,
+                .dest_mip = 0,
+                .dest_off = {
+                    (std::int32_t)(slot % _atlas_pages * _padded_page),
+                    (std::int32_t)(slot / _atlas_pages * _padded_page)
+                },
+                .extent = { _padded_page, _padded_page }
+            });
+            offset += _page_bytes;
+            _slots[slot].pending = false;
+            _slots[slot].last_used = _frame;
+            _textures[_locate(_slots[slot].page) >> 16].dirty = true;
+        }
+        _completed.erase(_completed.begin(), _completed.begin() + uploads);
+
+        qz_likely_if(_fresh || !copies.empty()) {
+            command_buffer
+                .insert_layout_transition({
+                    .image = &_atlas,
+                    .mip = 0,
+                    .levels = 0,
+                    .source_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                    .dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    .source_access = {},
+                    .dest_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+                    .old_layout = _fresh ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                    .new_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+                })
+                .copy_buffer_to_image(staging, _atlas, copies)
+                .insert_layout_transition({
+                    .image = &_atlas,
+                    .mip = 0,
+                    .levels = 0,
+                    .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    .dest_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                    .source_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+                    .dest_access = VK_ACCESS_SHADER_READ_BIT,
+                    .old_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    .new_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                });
+            _fresh = false;
+        }
+
+        // Indirection textures are small, changed ones are rewritten whole as long as they fit this frame.
+        for (auto& texture : _textures) {
+            const auto size = level_offset(texture.pages_x, texture.pages_y, texture.mips) * sizeof(std::uint32_t);
+            qz_likely_if(!texture.dirty || offset + size > staging.capacity) {
+                continue;
+            }
+            _write_indirection(texture, reinterpret_cast<std::uint32_t*>(mapped + offset));
+            copies.clear();
+            for (std::uint32_t mip = 0; mip < texture.mips; ++mip) {
+                copies.push_back({
+                    .source_off = offset + level_offset(texture.pages_x, texture.pages_y, mip) * sizeof(std::uint32_t),
+                    .dest_mip = mip,
+                    .dest_off = { 0, 0 },
+                    .extent = { level_size(texture.pages_x, mip), level_size(texture.pages_y, mip) }
+                });
+            }
+            offset += size;
+            command_buffer
+                .insert_layout_transition({
+                    .image = &texture.indirection,
+                    .mip = 0,
+                    .levels = 0,
+                    .source_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                    .dest_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    .source_access = {},
+                    .dest_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+                    .old_layout = texture.fresh ? VK_IMAGE_LAYOUT_UNDEFINED : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                    .new_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+                })
+                .copy_buffer_to_image(staging, texture.indirection, copies)
+                .insert_layout_transition({
+                    .image = &texture.indirection,
+                    .mip = 0,
+                    .levels = 0,
+                    .source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT,
+                    .dest_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                    .source_access = VK_ACCESS_TRANSFER_WRITE_BIT,
+                    .dest_access = VK_ACCESS_SHADER_READ_BIT,
+                    .old_layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    .new_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL
+                });
+            texture.dirty = false;
+            texture.fresh = false;
+        }
+        vmaFlushAllocation(context.allocator, staging.allocation, 0, VK_WHOLE_SIZE);
+
+        // Each frame has its own copy, frames still in flight keep seeing the textures as they were.
+        auto* info = static_cast<VirtualInfo*>(_info[frame].mapped);
+        for (std::size_t i = 0; i < _textures.size(); ++i) {
+            const auto& texture = _textures[i];
+            qz_likely_if(!texture.fresh) {
+                info[i] = {
+                    (std::uint32_t)texture.handle.index,
+                    (std::uint32_t)_atlas_handle.index,
+                    texture.pages_x,
+                    texture.pages_y,
+                    texture.mips,
+                    texture.first_page,
+                    _atlas_pages,
+                    _page_size,
+                    _page_border
+                };
+            }
+        }
+        vmaFlushAllocation(context.allocator, _info[frame].allocation, 0, VK_WHOLE_SIZE);
+    }
+
+    qz_nodiscard std::uint32_t VirtualTextureCache::pending() noexcept {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _in_flight;
+    }
+
+    qz_nodiscard Buffer<1> VirtualTextureCache::info(std::size_t index) const noexcept {
+        return Buffer<1>::from_raw(StaticBuffer(_info[index]), _info[index].capacity);
+    }
+
+    qz_nodiscard Buffer<1> VirtualTextureCache::feedback(std::size_t index) const noexcept {
+        return Buffer<1>::from_raw(StaticBuffer(_feedback[index]), _feedback[index].capacity);
+    }
+
+    // Returns the texture owning the page in the upper 16 bits and the page's mip in the lower 16.
+    qz_nodiscard std::uint32_t VirtualTextureCache::_locate(std::uint32_t page) const noexcept {
+        const auto it = std::upper_bound(_textures.begin(), _textures.end(), page, [](const auto page, const auto& texture) {
+            return page < texture.first_page;
+        }) - 1;
+        const auto local = page - it->first_page;
+        std::uint32_t mip = 0;
+        while (mip + 1 < it->mips && local >= level_offset(it->pages_x, it->pages_y, mip + 1)) {
+            ++mip;
+        }
+        return (std::uint32_t)(it - _textures.begin()) << 16 | mip;
+    }
+
+    // Picks a free slot, or the least recently used one that cooled down, ~0u if all are busy.
+    qz_nodiscard std::uint32_t VirtualTextureCache::_acquire_slot() const noexcept {
+        auto result = ~0u;
+        for (std::uint32_t i = 0; i < _slots.size(); ++i) {
+            const auto& slot = _slots[i];
+            qz_unlikely_if(slot.page == ~0u) {
+                return i;
+            }
+            qz_likely_if(slot.pending || slot.pinned || slot.last_used + cooling_frames >= _frame) {
+                continue;
+            }
+            qz_unlikely_if(result == ~0u || slot.last_used < _slots[result].last_used) {
+                result = i;
+            }
+        }
+        return result;
+    }
+
+    void VirtualTextureCache::_issue(const Context& context, std::uint32_t page, std::uint32_t index, bool pinned) noexcept {
+        auto& slot = _slots[index];
+        qz_unlikely_if(slot.page != ~0u) {
+            _page_slots[slot.page] = ~0u;
+            _textures[_locate(slot.page) >> 16].dirty = true;
+        }
+        slot = { page, _frame, true, pinned };
+        _page_slots[page] = index;
+        ++_in_flight;
+
+        const auto& texture = _textures[_locate(page) >> 16];
+        const auto* texels =
+            static_cast<const std::uint8_t*>(texture.file.data()) +
+            sizeof(VirtualTextureHeader) +
+            (page - texture.first_page) * _page_bytes;
+        // Copying out of the mapping is what actually reads the page from disk, that's left to the I/O threads.
+        context.io->post([this, texels, index]() {
+            _complete(index, std::vector<std::uint8_t>(texels, texels + _page_bytes));
+        });
+    }
+
+    void VirtualTextureCache::_complete(std::uint32_t slot, std::vector<std::uint8_t>&& texels) noexcept {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _completed.push_back({ slot, std::move(texels) });
+        --_in_flight;
+    }
+
+    // Every page points at itself when resident, otherwise at whatever its parent page points at.
+    void VirtualTextureCache::_write_indirection(const Texture& texture, std::uint32_t* entries) const noexcept {
+        for (auto mip = texture.mips; mip-- > 0;) {
+            const auto width = level_size(texture.pages_x, mip);
+            const auto height = level_size(texture.pages_y, mip);
+            const auto offset = level_offset(texture.pages_x, texture.pages_y, mip);
+            const auto parent_width = level_size(texture.pages_x, mip + 1);
+            const auto parent_height = level_size(texture.pages_y, mip + 1);
+            const auto* parent = entries + level_offset(texture.pages_x, texture.pages_y, mip + 1);
+            for (std::uint32_t y = 0; y < height; ++y) {
+                for (std::uint32_t x = 0; x < width; ++x) {
+                    const auto slot = _page_slots[texture.first_page + offset + y * width + x];
+                    auto& entry = entries[offset + y * width + x];
+                    qz_likely_if(slot != ~0u && !_slots[slot].pending) {
+                        entry = slot % _atlas_pages | slot / _atlas_pages << 8 | mip << 16 | 0xffu << 24;
+                    } else if (mip + 1 < texture.mips) {
+                        const auto parent_x = std::min((2 * x + 1) * parent_width / (2 * width), parent_width - 1);
+                        const auto parent_y = std::min((2 * y + 1) * parent_height / (2 * height), parent_height - 1);
+                        entry = parent[parent_y * parent_width + parent_x];
+                    } else {
+                        entry = 0;
+                    }
+                }
+            }
+        }
+    }
+} // namespace qz::gfx
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <qz/gfx/static_texture.hpp>
+#include <qz/gfx/static_buffer.hpp>
+#include <qz/gfx/buffer.hpp>
+#include <qz/gfx/image.hpp>
+
+#include <qz/meta/types.hpp>
+
+#include <qz/util/file_view.hpp>
+#include <qz/util/macros.hpp>
+#include <qz/util/fwd.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include <string_view>
+#include <optional>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <mutex>
+
+namespace qz::gfx {
+    // A ".qvt" file is this header followed by every page of every mip, finest mip first and row major.
+    // Each page is stored with its filtering border, (page_size + 2 * border)^2 RGBA8 sRGB texels.
+    // The coarsest mip must be a single page, it's kept resident as the fallback for everything else.
+    struct VirtualTextureHeader {
+        char magic[4];
+        std::uint32_t pages_x;
+        std::uint32_t pages_y;
+        std::uint32_t page_size;
+        std::uint32_t border;
+        std::uint32_t mips;
+    };
+
+    // Streams the pages of pre-tiled virtual textures into a shared physical atlas. An indirection
+    // texture per virtual texture maps each of its pages to the finest resident page covering it,
+    // the fragment shader reports the pages it wanted through a per frame bitmap.
+    class VirtualTextureCache {
+        struct Texture {
+            util::FileView file;
+            meta::Handle<StaticTexture> handle;
+            Image indirection;
+            std::uint32_t pages_x;
+            std::uint32_t pages_y;
+            std::uint32_t mips;
+            std::uint32_t first_page;
+            bool dirty;
+            bool fresh;
+        };
+        struct Slot {
+            std::uint32_t page;
+            std::uint64_t last_used;
+            bool pending;
+            bool pinned;
+        };
+        struct Upload {
+            std::uint32_t slot;
+            std::vector<std::uint8_t> texels;
+        };
+        meta::in_flight_array_t<StaticBuffer> _feedback;
+        meta::in_flight_array_t<StaticBuffer> _staging;
+        meta::in_flight_array_t<StaticBuffer> _info;
+        meta::Handle<StaticTexture> _atlas_handle;
+        Image _atlas;
+        std::vector<Texture> _textures;
+        std::vector<Slot> _slots;
+        std::vector<std::uint32_t> _page_slots;
+        std::vector<Upload> _completed;
+        std::size_t _page_bytes;
+        std::uint32_t _page_size;
+        std::uint32_t _page_border;
+        std::uint32_t _padded_page;
+        std::uint32_t _atlas_pages;
+        std::uint32_t _in_flight;
+        std::uint64_t _frame;
+        bool _fresh;
+        std::mutex _mutex;
+
+        qz_nodiscard std::uint32_t _locate(std::uint32_t) const noexcept;
+        qz_nodiscard std::uint32_t _acquire_slot() const noexcept;
+        void _issue(const Context&, std::uint32_t, std::uint32_t, bool) noexcept;
+        void _complete(std::uint32_t, std::vector<std::uint8_t>&&) noexcept;
+        void _write_indirection(const Texture&, std::uint32_t*) const noexcept;
+    public:
+        qz_nodiscard static std::unique_ptr<VirtualTextureCache> create(const Context&, const Settings&) noexcept;
+        static void destroy(const Context&, VirtualTextureCache&) noexcept;
+
+        qz_nodiscard std::optional<std::uint32_t> request(const Context&, std::string_view) noexcept;
+        void update(const Context&, std::uint32_t) noexcept;
+        void record(const Context&, CommandBuffer&, std::uint32_t) noexcept;
+        qz_nodiscard std::uint32_t pending() noexcept;
+        qz_nodiscard Buffer<1> info(std::size_t) const noexcept;
+        qz_nodiscard Buffer<1> feedback(std::size_t) const noexcept;
+    };
+} // namespace qz::gfx
@@ -3,6 +3,7 @@
 #include <GLFW/glfw3.h>
 
 #include <iostream>
+#include <chrono>
 
 namespace qz::gfx {
     qz_nodiscard Window::Window(GLFWwindow* handle, std::uint32_t width, std::uint32_t height) noexcept
@@ -105,7 +106,8 @@ namespace qz::gfx {
         return _moved ? _mouse_off : Point{};
     }
 
+    // Independent of GLFW, headless runs never initialize it.
     qz_nodiscard double get_time() noexcept {
-        return glfwGetTime();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
     }
 } // namespace qz::gfx
\ No newline at end of file
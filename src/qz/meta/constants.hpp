@@ -11,8 +11,13 @@ namespace qz::meta {
     };
 
     constexpr auto dynamic_size = 256u;
-    constexpr auto in_flight = 2u;
+    // Per frame resources are allocated for this many frames, the renderer cycles through as many as configured.
+    constexpr auto max_in_flight = 3u;
     constexpr auto external_subpass = ~0u;
     constexpr auto family_ignored = ~0u;
     constexpr auto default_texture = 0u;
+    constexpr auto max_textures = 4096u;
+    constexpr auto virtual_texture_bit = 1u << 31;
+    constexpr auto max_virtual_textures = 64u;
+    constexpr auto max_virtual_pages = 1u << 20;
 } // namespace qz::meta
\ No newline at end of file
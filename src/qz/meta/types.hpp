@@ -12,7 +12,7 @@
 
 namespace qz::meta {
     template <typename T>
-    using in_flight_array_t = std::array<T, in_flight>;
+    using in_flight_array_t = std::array<T, max_in_flight>;
 
     template <typename T>
     struct Handle {
@@ -0,0 +1,28 @@
+#include <qz/util/affinity.hpp>
+
+#if defined(_WIN32)
+    #include <Windows.h>
+#elif defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+namespace qz::util {
+    void set_thread_affinity(std::uint64_t mask) noexcept {
+        if (!mask) {
+            return;
+        }
+#if defined(_WIN32)
+        SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)mask);
+#elif defined(__linux__)
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (std::uint32_t core = 0; core < 64; ++core) {
+            if (mask & (1ull << core)) {
+                CPU_SET(core, &set);
+            }
+        }
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+    }
+} // namespace qz::util
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+
+namespace qz::util {
+    // Restricts the calling thread to the cores set in the mask, zero leaves it unrestricted.
+    void set_thread_affinity(std::uint64_t) noexcept;
+} // namespace qz::util
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <qz/util/macros.hpp>
+
+#include <cstddef>
+#include <atomic>
+
+namespace qz::util {
+    constexpr auto bump_exhausted = ~(std::size_t)0;
+
+    // Reserves an aligned range out of [0, capacity) by advancing the head, safe to call from any thread.
+    // Returns the range's start, or bump_exhausted without moving the head if it doesn't fit anymore.
+    qz_nodiscard inline std::size_t bump_allocate(std::atomic<std::size_t>& head, std::size_t size, std::size_t alignment, std::size_t capacity) noexcept {
+        auto current = head.load(std::memory_order_relaxed);
+        std::size_t start;
+        do {
+            start = (current + alignment - 1) & ~(alignment - 1);
+            qz_unlikely_if(start > capacity || size > capacity - start) {
+                return bump_exhausted;
+            }
+        } while (!head.compare_exchange_weak(current, start + size, std::memory_order_relaxed));
+        return start;
+    }
+} // namespace qz::util
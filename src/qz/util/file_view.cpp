@@ -9,7 +9,8 @@
 #endif
 
 namespace qz::util {
-    qz_nodiscard FileView FileView::create(std::string_view path) noexcept {
+    // Populated views are read in full up front, so that nobody touching them later faults on the disk.
+    qz_nodiscard FileView FileView::create(std::string_view path, bool populate) noexcept {
         FileView file{};
 #if defined(_WIN32)
         file._handle = CreateFile(path.data(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
@@ -20,10 +21,23 @@ namespace qz::util {
         const auto file_desc = open(path.data(), O_RDONLY);
         struct stat file_info{};
         qz_assert(fstat(file_desc, &file_info) != -1, "failed to get file info");
-        file._data = mmap(nullptr, file_info.st_size, PROT_READ, MAP_PRIVATE, file_desc, 0);
+#if defined(MAP_POPULATE)
+        const auto flags = MAP_PRIVATE | (populate ? MAP_POPULATE : 0);
+        populate = false;
+#else
+        const auto flags = MAP_PRIVATE;
+#endif
+        file._data = mmap(nullptr, file_info.st_size, PROT_READ, flags, file_desc, 0);
         file._size = file_info.st_size;
 #endif
         qz_assert(file._data, "file not found");
+        if (populate) {
+            std::uint8_t sum = 0;
+            for (std::size_t offset = 0; offset < file._size; offset += 4096) {
+                sum += static_cast<const volatile std::uint8_t*>(file._data)[offset];
+            }
+            (void)sum;
+        }
         return file;
     }
 
@@ -14,7 +14,7 @@ namespace qz::util {
         const void* _data;
         std::size_t _size;
     public:
-        qz_nodiscard static FileView create(std::string_view) noexcept;
+        qz_nodiscard static FileView create(std::string_view, bool = false) noexcept;
         static void destroy(FileView&) noexcept;
 
         qz_nodiscard const void* data() const noexcept;
@@ -3,6 +3,7 @@
 struct GLFWwindow; // Ugly thing.
 namespace qz::gfx {
     struct Window;
+    struct Settings;
     struct Context;
     struct Renderer;
 
@@ -23,6 +24,30 @@ namespace qz::gfx {
     template <typename>
     struct TaskData;
     struct StaticModel;
+    class DeletionQueue;
+    class TextureStreamer;
+    class VirtualTextureCache;
+    class TextureAtlas;
+    struct StagingBlock;
+    class StagingRing;
+    struct BufferUpload;
+    struct ImageUpload;
+    struct UploadRequest;
+    struct UploadBacklog;
+    class UploadBatcher;
+    class RecyclingPool;
+    class TransferScheduler;
+    struct TaskRecord;
+    class TaskManager;
+    struct TaskNode;
+    class TaskGraph;
+    class IoPool;
+    template <typename>
+    class GpuVector;
+    struct FrameAllocation;
+    class FrameAllocator;
+    struct TransformUpdate;
+    class TransformStore;
 } // namespace qz::gfx
 
 namespace qz::meta {
@@ -0,0 +1,153 @@
+#include <qz/util/pixels.hpp>
+
+#if defined(__x86_64__) || defined(_M_X64)
+    #define qz_pixels_simd
+    #include <immintrin.h>
+    #if defined(_MSC_VER) && !defined(__clang__)
+        #include <intrin.h>
+        #define qz_target(isa)
+    #else
+        #define qz_target(isa) __attribute__((target(isa)))
+    #endif
+#endif
+
+#include <cstring>
+
+namespace qz::util {
+    static void convert_scalar(const std::uint8_t* source,
+                               std::uint32_t channels,
+                               std::uint8_t* dest,
+                               std::uint32_t components,
+                               std::size_t texels) noexcept {
+        for (std::size_t i = 0; i < texels; ++i, source += channels, dest += components) {
+            const auto gray = channels < 3;
+            const auto alpha = channels == 2 || channels == 4 ? source[channels - 1] : (std::uint8_t)255;
+            switch (components) {
+                case 1:
+                    dest[0] = source[0];
+                    break;
+                case 2:
+                    dest[0] = source[0];
+                    dest[1] = gray ? source[0] : source[1];
+                    break;
+                case 4:
+                    dest[0] = source[0];
+                    dest[1] = gray ? source[0] : source[1];
+                    dest[2] = gray ? source[0] : source[2];
+                    dest[3] = alpha;
+                    break;
+            }
+        }
+    }
+
+#if defined(qz_pixels_simd)
+    qz_nodiscard static bool has_ssse3() noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuid(info, 1);
+        return info[2] & (1 << 9);
+#else
+        return __builtin_cpu_supports("ssse3");
+#endif
+    }
+
+    qz_nodiscard static bool has_avx2() noexcept {
+#if defined(_MSC_VER) && !defined(__clang__)
+        int info[4];
+        __cpuidex(info, 7, 0);
+        return info[1] & (1 << 5);
+#else
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+    // Every kernel returns how many texels it converted, the scalar path finishes the rest.
+    // Loads are 16 bytes wide, so kernels stop while a full load still fits in the source.
+    qz_target("ssse3") static std::size_t rgb_to_rgba_ssse3(const std::uint8_t* source, std::uint8_t* dest, std::size_t texels) noexcept {
+        const auto shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const auto alpha = _mm_set1_epi32((int)0xff000000);
+        std::size_t i = 0;
+        for (; i + 6 <= texels; i += 4) {
+            const auto pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 4), _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), alpha));
+        }
+        return i;
+    }
+
+    qz_target("avx2") static std::size_t rgb_to_rgba_avx2(const std::uint8_t* source, std::uint8_t* dest, std::size_t texels) noexcept {
+        // Shuffles don't cross 128 bit lanes, each lane is loaded with its own 4 texels.
+        const auto shuffle = _mm256_setr_epi8(
+            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1,
+            0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+        const auto alpha = _mm256_set1_epi32((int)0xff000000);
+        std::size_t i = 0;
+        for (; i + 10 <= texels; i += 8) {
+            const auto low = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+            const auto high = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3 + 12));
+            const auto pixels = _mm256_inserti128_si256(_mm256_castsi128_si256(low), high, 1);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i * 4), _mm256_or_si256(_mm256_shuffle_epi8(pixels, shuffle), alpha));
+        }
+        return i;
+    }
+
+    qz_target("ssse3") static std::size_t gray_to_rgba_ssse3(const std::uint8_t* source, std::uint8_t* dest, std::size_t texels) noexcept {
+        const auto shuffle = _mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1);
+        const auto alpha = _mm_set1_epi32((int)0xff000000);
+        std::size_t i = 0;
+        for (; i + 16 <= texels; i += 16) {
+            auto pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+            for (std::size_t j = 0; j < 4; ++j, pixels = _mm_srli_si128(pixels, 4)) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + (i + j * 4) * 4), _mm_or_si128(_mm_shuffle_epi8(pixels, shuffle), alpha));
+            }
+        }
+        return i;
+    }
+
+    qz_target("ssse3") static std::size_t rgba_to_rg_ssse3(const std::uint8_t* source, std::uint8_t* dest, std::size_t texels) noexcept {
+        const auto shuffle = _mm_setr_epi8(0, 1, 4, 5, 8, 9, 12, 13, -1, -1, -1, -1, -1, -1, -1, -1);
+        std::size_t i = 0;
+        for (; i + 4 <= texels; i += 4) {
+            const auto pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 4));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + i * 2), _mm_shuffle_epi8(pixels, shuffle));
+        }
+        return i;
+    }
+
+    qz_target("ssse3") static std::size_t rgb_to_rg_ssse3(const std::uint8_t* source, std::uint8_t* dest, std::size_t texels) noexcept {
+        const auto shuffle = _mm_setr_epi8(0, 1, 3, 4, 6, 7, 9, 10, -1, -1, -1, -1, -1, -1, -1, -1);
+        std::size_t i = 0;
+        for (; i + 6 <= texels; i += 4) {
+            const auto pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i * 3));
+            _mm_storel_epi64(reinterpret_cast<__m128i*>(dest + i * 2), _mm_shuffle_epi8(pixels, shuffle));
+        }
+        return i;
+    }
+#endif
+
+    void convert_pixels(const std::uint8_t* source,
+                        std::uint32_t channels,
+                        std::uint8_t* dest,
+                        std::uint32_t components,
+                        std::size_t texels) noexcept {
+        qz_likely_if(channels == components) {
+            std::memcpy(dest, source, texels * components);
+            return;
+        }
+        std::size_t done = 0;
+#if defined(qz_pixels_simd)
+        // x86-64 only guarantees SSE2, CPUs without SSSE3 take the scalar path for everything.
+        static const auto ssse3 = has_ssse3();
+        static const auto avx2 = has_avx2();
+        qz_likely_if(ssse3) {
+            switch (channels * 10 + components) {
+                case 34: done = avx2 ? rgb_to_rgba_avx2(source, dest, texels) : rgb_to_rgba_ssse3(source, dest, texels); break;
+                case 14: done = gray_to_rgba_ssse3(source, dest, texels); break;
+                case 42: done = rgba_to_rg_ssse3(source, dest, texels); break;
+                case 32: done = rgb_to_rg_ssse3(source, dest, texels); break;
+                default: break;
+            }
+        }
+#endif
+        convert_scalar(source + done * channels, channels, dest + done * components, components, texels - done);
+    }
+} // namespace qz::util
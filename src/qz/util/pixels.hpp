@@ -0,0 +1,11 @@
+#pragma once
+
+#include <qz/util/macros.hpp>
+
+#include <cstdint>
+#include <cstddef>
+
+namespace qz::util {
+    // Repacks pixels between 8 bit layouts, grayscale sources are splatted and missing alpha is opaque.
+    void convert_pixels(const std::uint8_t*, std::uint32_t, std::uint8_t*, std::uint32_t, std::size_t) noexcept;
+} // namespace qz::util
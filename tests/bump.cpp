@@ -0,0 +1,39 @@
+#include <qz/util/bump.hpp>
+
+#include <cstdlib>
+#include <cstdio>
+#include <atomic>
+
+using namespace qz;
+
+#define check(expr)                                                              \
+    do {                                                                         \
+        if (!(expr)) {                                                           \
+            std::printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #expr); \
+            return EXIT_FAILURE;                                                 \
+        }                                                                        \
+    } while (false)
+
+int main() {
+    std::atomic<std::size_t> head = 0;
+
+    // Ranges are aligned and packed one after another.
+    check(util::bump_allocate(head, 24, 16, 64) == 0);
+    check(util::bump_allocate(head, 8, 16, 64) == 32);
+    check(head.load() == 40);
+
+    // Allocating past the capacity fails and leaves the head where it was.
+    check(util::bump_allocate(head, 32, 16, 64) == util::bump_exhausted);
+    check(head.load() == 40);
+
+    // Whatever still fits can be allocated afterwards, up to exactly the capacity.
+    check(util::bump_allocate(head, 16, 16, 64) == 48);
+    check(head.load() == 64);
+    check(util::bump_allocate(head, 1, 1, 64) == util::bump_exhausted);
+
+    // Sizes that would overflow the address space don't wrap around.
+    head = 0;
+    check(util::bump_allocate(head, util::bump_exhausted, 1, 64) == util::bump_exhausted);
+    check(head.load() == 0);
+    return EXIT_SUCCESS;
+}